@@ -55,6 +55,9 @@
 #include <qvarlengtharray.h>
 #include <qvector.h>
 #include <qmath.h>
+#include <qmutex.h>
+#include <qelapsedtimer.h>
+#include <qloggingcategory.h>
 #include <QDebug>
 #include <QSqlQuery>
 #include <QtSql/private/qsqldriver_p.h>
@@ -62,31 +65,42 @@
 
 QT_BEGIN_NAMESPACE
 
+Q_LOGGING_CATEGORY(lcOdbcSlow, "qt.sql.odbc.slow")
+
 // undefine this to prevent initial check of the ODBC driver
 #define ODBC_CHECK_DRIVER
 
 static const int COLNAMESIZE = 256;
+// Block cursor limits: rows fetched per round trip, the largest column
+// (in characters or bytes) that is bound, and the memory used by one rowset.
+static const int ROWARRAYSIZE = 256;
+static const int MAXBOUNDCOLSIZE = 1024;
+static const int MAXROWSETBYTES = 1024 * 1024;
+// Number of idle prepared statement handles kept per connection.
+static const int STMTCACHESIZE = 16;
+// Statements taking longer than this (execute and fetch) are logged to lcOdbcSlow.
+static const qint64 SLOWSTATEMENTMSECS = 1000;
 static const SQLSMALLINT TABLENAMESIZE = 128;
 //Map Qt parameter types to ODBC types
 static const SQLSMALLINT qParamType[4] = { SQL_PARAM_INPUT, SQL_PARAM_INPUT, SQL_PARAM_OUTPUT, SQL_PARAM_INPUT_OUTPUT };
 
-inline static QString fromSQLTCHAR(const QVarLengthArray<SQLTCHAR>& input, int size=-1)
+inline static QString fromSQLTCHAR(const SQLTCHAR *input, int size)
 {
     QString result;
 
     // Remove any trailing \0 as some drivers misguidedly append one
-    int realsize = qMin(size, input.size());
+    int realsize = size;
     if(realsize > 0 && input[realsize-1] == 0)
         realsize--;
     switch(sizeof(SQLTCHAR)) {
         case 1:
-            result=QString::fromUtf8((const char *)input.constData(), realsize);
+            result=QString::fromUtf8((const char *)input, realsize);
             break;
         case 2:
-            result=QString::fromUtf16((const ushort *)input.constData(), realsize);
+            result=QString::fromUtf16((const ushort *)input, realsize);
             break;
         case 4:
-            result=QString::fromUcs4((const uint *)input.constData(), realsize);
+            result=QString::fromUcs4((const uint *)input, realsize);
             break;
         default:
             qCritical("sizeof(SQLTCHAR) is %d. Don't know how to handle this.", int(sizeof(SQLTCHAR)));
@@ -94,6 +108,11 @@ inline static QString fromSQLTCHAR(const QVarLengthArray<SQLTCHAR>& input, int s
     return result;
 }
 
+inline static QString fromSQLTCHAR(const QVarLengthArray<SQLTCHAR>& input, int size=-1)
+{
+    return fromSQLTCHAR(input.constData(), qMin(size, input.size()));
+}
+
 inline static QVarLengthArray<SQLTCHAR> toSQLTCHAR(const QString &input)
 {
     QVarLengthArray<SQLTCHAR> result;
@@ -133,12 +152,48 @@ public:
     bool isFreeTDSDriver = false;
     bool hasSQLFetchScroll = true;
     bool hasMultiResultSets = false;
+    bool hasBlockCursor = false;
+    // SQL_GETDATA_EXTENSIONS, tells if SQLGetData() works on a block cursor row positioned with SQLSetPos()
+    SQLUINTEGER getDataExtensions = 0;
+
+    // Statement currently executing, used by cancelQuery() from other threads.
+    QMutex executingMutex;
+    SQLHANDLE executingStmt = nullptr;
+
+    // Idle prepared statements, most recently used first.
+    struct CachedStatement {
+        SQLHANDLE hStmt;
+        bool forwardOnly;
+        QString query;
+    };
+    QList<CachedStatement> statementCache;
+
+    // Counters exposed through QODBCDriver::statistics(), only updated and
+    // read from the thread using the connection.
+    struct Statistics {
+        qint64 prepares = 0;
+        qint64 cachedPrepares = 0;
+        qint64 executes = 0;
+        qint64 fetches = 0;
+        qint64 rows = 0;
+        qint64 bytes = 0;
+        qint64 prepareNsecs = 0;
+        qint64 executeNsecs = 0;
+        qint64 fetchNsecs = 0;
+        qint64 diagnostics = 0;
+        qint64 slowStatements = 0;
+    };
+    Statistics stats;
+
+    SQLHANDLE takeCachedStatement(const QString &query, bool forwardOnly);
+    void cacheStatement(SQLHANDLE hStmt, const QString &query, bool forwardOnly);
 
     bool checkDriver() const;
     void checkUnicode();
     void checkDBMS();
     void checkHasSQLFetchScroll();
     void checkHasMultiResults();
+    void checkGetDataExtensions();
     void checkSchemaUsage();
     void checkDateTimePrecision();
     bool setConnectionOptions(const QString& connOpts);
@@ -164,6 +219,7 @@ public:
 
     bool prepare(const QString &query) override;
     bool exec() override;
+    bool execBatch(bool arrayBind = false) override;
 
     QVariant lastInsertId() const override;
     QVariant handle() const override;
@@ -199,10 +255,12 @@ public:
         disconnectCount = drv_d_func()->disconnectCount;
         isFreeTDSDriver = drv_d_func()->isFreeTDSDriver;
         hasSQLFetchScroll = drv_d_func()->hasSQLFetchScroll;
+        hasBlockCursor = drv_d_func()->hasBlockCursor && hasSQLFetchScroll;
+        getDataExtensions = drv_d_func()->getDataExtensions;
     }
 
     inline void clearValues()
-    { fieldCache.fill(QVariant()); fieldCacheIdx = 0; }
+    { fieldCache.fill(QVariant()); fieldCacheIdx = 0; rowsetPositioned = false; }
 
     SQLHANDLE dpEnv() const { return drv_d_func() ? drv_d_func()->hEnv : 0;}
     SQLHANDLE dpDbc() const { return drv_d_func() ? drv_d_func()->hDbc : 0;}
@@ -216,9 +274,64 @@ public:
     bool hasSQLFetchScroll = true;
     bool unicode = false;
     bool useSchema = false;
+    bool hasBlockCursor = false;
+    SQLUINTEGER getDataExtensions = 0;
+
+    // Column-wise bound rowset, used for forward only result sets. Columns
+    // that can't be bound and truncated values are read with SQLGetData()
+    // into fieldCache, in column order, once the row is positioned.
+    struct ColumnBuffer {
+        bool bound = true;
+        QVariant::Type type = QVariant::Invalid;
+        SQLSMALLINT cType = 0;
+        SQLLEN width = 0;
+        QByteArray data;
+        QVector<SQLLEN> indicators;
+    };
+    QVector<ColumnBuffer> columnBuffers;
+    SQLULEN rowsFetched = 0;
+    SQLULEN rowsetPos = 0;
+    bool blockCursor = false;
+    bool rowsetPositioned = false;
+
+    // Reusable buffer for string columns fetched with SQLGetData()
+    QByteArray stringBuffer;
+
+    // SQL text hStmt was prepared with, set when the handle can be cached
+    QString preparedQuery;
+    bool preparedForwardOnly = false;
+
+    // Parameter buffers bound to hStmt and the input values they hold
+    QVector<QVariant> paramValues;
+    QVector<QByteArray> paramStorage;
+    QVector<SQLLEN> paramIndicators;
+
+    // Time, rows and bytes of the statement executed last, for the slow statement log
+    qint64 stmtNsecs = 0;
+    qint64 stmtRows = 0;
+    qint64 stmtBytes = 0;
 
     bool isStmtHandleValid() const;
     void updateStmtHandleState();
+    bool releaseStatement();
+    void resizeParams(int count);
+    bool isParamBound(int i, const QVariant &val) const;
+    void setExecuting(bool executing);
+    bool bindColumns(QSql::NumericalPrecisionPolicy policy);
+    void unbindColumns();
+    QVariant boundValue(int field) const;
+    bool isTruncated(int field) const;
+    bool needsGetData(int field) const;
+    QVariant getData(int field, QSql::NumericalPrecisionPolicy policy);
+    QVariant rowsetValue(int field, QSql::NumericalPrecisionPolicy policy);
+    bool isBoundNull(int field) const;
+
+    QODBCDriverPrivate::Statistics *statistics() const;
+    void addPrepare(qint64 nsecs, SQLRETURN r);
+    void addExecute(qint64 nsecs, SQLRETURN r);
+    void addFetch(qint64 nsecs, SQLRETURN r);
+    void addRows(qint64 rows, qint64 bytes);
+    void finishStatement();
 };
 
 bool QODBCResultPrivate::isStmtHandleValid() const
@@ -231,6 +344,140 @@ void QODBCResultPrivate::updateStmtHandleState()
     disconnectCount = drv_d_func() ? drv_d_func()->disconnectCount : 0;
 }
 
+QODBCDriverPrivate::Statistics *QODBCResultPrivate::statistics() const
+{
+    QODBCDriverPrivate *dd = const_cast<QODBCDriverPrivate *>(drv_d_func());
+    return dd ? &dd->stats : nullptr;
+}
+
+void QODBCResultPrivate::addPrepare(qint64 nsecs, SQLRETURN r)
+{
+    if (QODBCDriverPrivate::Statistics *s = statistics()) {
+        s->prepares++;
+        s->prepareNsecs += nsecs;
+        if (r != SQL_SUCCESS && r != SQL_NO_DATA)
+            s->diagnostics++;
+    }
+}
+
+void QODBCResultPrivate::addExecute(qint64 nsecs, SQLRETURN r)
+{
+    stmtNsecs += nsecs;
+    if (QODBCDriverPrivate::Statistics *s = statistics()) {
+        s->executes++;
+        s->executeNsecs += nsecs;
+        if (r != SQL_SUCCESS && r != SQL_NO_DATA)
+            s->diagnostics++;
+    }
+}
+
+void QODBCResultPrivate::addFetch(qint64 nsecs, SQLRETURN r)
+{
+    stmtNsecs += nsecs;
+    if (QODBCDriverPrivate::Statistics *s = statistics()) {
+        s->fetches++;
+        s->fetchNsecs += nsecs;
+        if (r != SQL_SUCCESS && r != SQL_NO_DATA)
+            s->diagnostics++;
+    }
+}
+
+void QODBCResultPrivate::addRows(qint64 rows, qint64 bytes)
+{
+    stmtRows += rows;
+    stmtBytes += bytes;
+    if (QODBCDriverPrivate::Statistics *s = statistics()) {
+        s->rows += rows;
+        s->bytes += bytes;
+    }
+}
+
+// Called before the statement is executed again or released
+void QODBCResultPrivate::finishStatement()
+{
+    if (stmtNsecs >= SLOWSTATEMENTMSECS * 1000000) {
+        if (QODBCDriverPrivate::Statistics *s = statistics())
+            s->slowStatements++;
+        qCInfo(lcOdbcSlow).nospace() << "Slow statement: " << stmtNsecs / 1000000 << " ms, "
+                                     << stmtRows << " rows, " << stmtBytes << " bytes: "
+                                     << sql;
+    }
+    stmtNsecs = 0;
+    stmtRows = 0;
+    stmtBytes = 0;
+}
+
+static qint64 qValueSize(const QVariant &value)
+{
+    if (value.isNull())
+        return 0;
+    switch (value.userType()) {
+    case QVariant::String:
+        return value.toString().size() * qint64(sizeof(QChar));
+    case QVariant::ByteArray:
+        return value.toByteArray().size();
+    default:
+        return QMetaType::sizeOf(value.userType());
+    }
+}
+
+// Returns the statement handle to the driver's cache if it holds a prepared
+// statement, frees it otherwise.
+bool QODBCResultPrivate::releaseStatement()
+{
+    bool ok = true;
+    if (hStmt && isStmtHandleValid()) {
+        if (!preparedQuery.isEmpty()) {
+            QODBCDriverPrivate *dd = const_cast<QODBCDriverPrivate *>(drv_d_func());
+            dd->cacheStatement(hStmt, preparedQuery, preparedForwardOnly);
+        } else {
+            ok = SQLFreeHandle(SQL_HANDLE_STMT, hStmt) == SQL_SUCCESS;
+        }
+    }
+    hStmt = nullptr;
+    preparedQuery.clear();
+    paramValues.clear();
+    return ok;
+}
+
+void QODBCResultPrivate::resizeParams(int count)
+{
+    if (paramValues.size() == count)
+        return;
+    // the indicators may move, so everything has to be bound again
+    paramValues.clear();
+    paramValues.resize(count);
+    paramStorage.resize(count);
+    paramIndicators.fill(0, count);
+}
+
+bool QODBCResultPrivate::isParamBound(int i, const QVariant &val) const
+{
+    const QVariant &bound = paramValues.at(i);
+    return bound.isValid() && bound.userType() == val.userType()
+            && bound.isNull() == val.isNull() && (val.isNull() || bound == val);
+}
+
+// Input values are copied to a buffer owned by the result, output values
+// are written straight back into the bound QVariant.
+static void *qParamData(QByteArray &buffer, const QVariant &val, bool isOut)
+{
+    if (isOut)
+        return const_cast<void *>(val.constData());
+    buffer.resize(QMetaType::sizeOf(val.userType()));
+    memcpy(buffer.data(), val.constData(), buffer.size());
+    return buffer.data();
+}
+
+void QODBCResultPrivate::setExecuting(bool executing)
+{
+    QODBCDriverPrivate *dd = const_cast<QODBCDriverPrivate *>(drv_d_func());
+    if (!dd)
+        return;
+    QMutexLocker locker(&dd->executingMutex);
+    dd->executingStmt = executing ? hStmt : nullptr;
+}
+
 static QString qWarnODBCHandle(int handleType, SQLHANDLE handle, int *nativeCode = 0)
 {
     SQLINTEGER nativeCode_ = 0;
@@ -404,12 +651,72 @@ static QVariant::Type qDecodeODBCType(SQLSMALLINT sqltype, bool isSigned = true)
     return type;
 }
 
-static QString qGetStringData(SQLHANDLE hStmt, int column, int colSize, bool unicode = false)
+// Fetches a string column with a single SQLGetData() call into the reusable
+// scratch buffer when the column size is known. Returns false if the value was
+// truncated, fieldVal then holds the part fetched so far.
+static bool qGetStringDataFast(SQLHANDLE hStmt, int column, int colSize, bool unicode,
+                               QByteArray *scratch, QString *fieldVal)
+{
+    SQLLEN lengthIndicator = 0;
+    const SQLSMALLINT cType = unicode ? SQL_C_TCHAR : SQL_C_CHAR;
+    const int charSize = unicode ? int(sizeof(SQLTCHAR)) : 1;
+    // leave room for multibyte encodings and the 0 termination
+    const int bufSize = (colSize * (charSize == 1 ? 3 : 1) + 1) * charSize;
+    if (scratch->size() < bufSize)
+        scratch->resize(bufSize);
+
+    SQLRETURN r = SQLGetData(hStmt,
+                             column+1,
+                             cType,
+                             (SQLPOINTER)scratch->data(),
+                             bufSize,
+                             &lengthIndicator);
+    if (r == SQL_NO_DATA) {
+        fieldVal->clear();
+        return true;
+    }
+    if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO) {
+        qWarning() << "qGetStringData: Error while fetching data (" << qWarnODBCHandle(SQL_HANDLE_STMT, hStmt) << ')';
+        fieldVal->clear();
+        return true;
+    }
+    if (lengthIndicator == SQL_NULL_DATA) {
+        fieldVal->clear();
+        return true;
+    }
+
+    // on truncation the length indicator holds the total length (or
+    // SQL_NO_TOTAL), not the number of bytes returned
+    const bool truncated = lengthIndicator == SQL_NO_TOTAL || lengthIndicator >= SQLLEN(bufSize);
+    const int rSize = truncated ? bufSize / charSize - 1 : int(lengthIndicator / charSize);
+    if (unicode) {
+        *fieldVal = fromSQLTCHAR(reinterpret_cast<const SQLTCHAR *>(scratch->constData()), rSize);
+    } else {
+        // Remove any trailing \0 as some drivers misguidedly append one
+        int realsize = rSize;
+        if (realsize > 0 && scratch->at(realsize - 1) == 0)
+            realsize--;
+        *fieldVal = QString::fromUtf8(scratch->constData(), realsize);
+    }
+    return !truncated;
+}
+
+static QString qGetStringData(SQLHANDLE hStmt, int column, int colSize, bool unicode = false,
+                              QByteArray *scratch = nullptr)
 {
     QString fieldVal;
     SQLRETURN r = SQL_ERROR;
     SQLLEN lengthIndicator = 0;
 
+    // Try to fetch the whole value in one call, fall back to fetching
+    // the remainder in chunks if it didn't fit
+    bool probe = true;
+    if (scratch && colSize > 0 && colSize <= 65536) {
+        if (qGetStringDataFast(hStmt, column, colSize, unicode, scratch, &fieldVal))
+            return fieldVal;
+        probe = false;
+    }
+
     // NB! colSize must be a multiple of 2 for unicode enabled DBs
     if (colSize <= 0) {
         colSize = 256;
@@ -419,16 +726,17 @@ static QString qGetStringData(SQLHANDLE hStmt, int column, int colSize, bool uni
         colSize++; // make sure there is room for more than the 0 termination
     }
     if(unicode) {
-        r = SQLGetData(hStmt,
-                        column+1,
-                        SQL_C_TCHAR,
-                        NULL,
-                        0,
-                        &lengthIndicator);
-        if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && lengthIndicator > 0)
-            colSize = int(lengthIndicator / sizeof(SQLTCHAR) + 1);
+        if (probe) {
+            r = SQLGetData(hStmt,
+                            column+1,
+                            SQL_C_TCHAR,
+                            NULL,
+                            0,
+                            &lengthIndicator);
+            if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && lengthIndicator > 0)
+                colSize = int(lengthIndicator / sizeof(SQLTCHAR) + 1);
+        }
         QVarLengthArray<SQLTCHAR> buf(colSize);
-        memset(buf.data(), 0, colSize*sizeof(SQLTCHAR));
         while (true) {
             r = SQLGetData(hStmt,
                             column+1,
@@ -470,14 +778,16 @@ static QString qGetStringData(SQLHANDLE hStmt, int column, int colSize, bool uni
             }
         }
     } else {
-        r = SQLGetData(hStmt,
-                        column+1,
-                        SQL_C_CHAR,
-                        NULL,
-                        0,
-                        &lengthIndicator);
-        if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && lengthIndicator > 0)
-            colSize = lengthIndicator + 1;
+        if (probe) {
+            r = SQLGetData(hStmt,
+                            column+1,
+                            SQL_C_CHAR,
+                            NULL,
+                            0,
+                            &lengthIndicator);
+            if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && lengthIndicator > 0)
+                colSize = lengthIndicator + 1;
+        }
         QVarLengthArray<SQLCHAR> buf(colSize);
         while (true) {
             r = SQLGetData(hStmt,
@@ -741,6 +1051,311 @@ static QSqlField qMakeFieldInfo(const SQLHANDLE hStmt, int i, QString *errorMess
     return f;
 }
 
+bool QODBCResultPrivate::bindColumns(QSql::NumericalPrecisionPolicy policy)
+{
+    unbindColumns();
+    if (!hasBlockCursor || rInf.isEmpty())
+        return false;
+
+    // Columns that can't be bound are read with SQLGetData() if the driver
+    // allows that with block cursors, otherwise the rows are fetched one by one
+    const bool getDataBlock = getDataExtensions & SQL_GD_BLOCK;
+    QVector<ColumnBuffer> buffers(rInf.count());
+    SQLLEN rowSize = 0;
+    int firstUnbound = -1;
+    int lastBound = -1;
+    for (int i = 0; i < rInf.count(); ++i) {
+        const QSqlField info = rInf.field(i);
+        const int length = info.length();
+        ColumnBuffer &b = buffers[i];
+        b.type = info.type();
+        switch (info.type()) {
+        case QVariant::LongLong:
+            b.cType = SQL_C_SBIGINT;
+            b.width = sizeof(SQLBIGINT);
+            break;
+        case QVariant::ULongLong:
+            b.cType = SQL_C_UBIGINT;
+            b.width = sizeof(SQLUBIGINT);
+            break;
+        case QVariant::Int:
+            b.cType = SQL_C_SLONG;
+            b.width = sizeof(SQLINTEGER);
+            break;
+        case QVariant::UInt:
+            b.cType = SQL_C_ULONG;
+            b.width = sizeof(SQLUINTEGER);
+            break;
+        case QVariant::Date:
+            b.cType = SQL_C_DATE;
+            b.width = sizeof(DATE_STRUCT);
+            break;
+        case QVariant::Time:
+            b.cType = SQL_C_TIME;
+            b.width = sizeof(TIME_STRUCT);
+            break;
+        case QVariant::DateTime:
+            b.cType = SQL_C_TIMESTAMP;
+            b.width = sizeof(TIMESTAMP_STRUCT);
+            break;
+        case QVariant::ByteArray:
+            if (length <= 0 || length > MAXBOUNDCOLSIZE) {
+                b.bound = false;
+                break;
+            }
+            b.cType = SQL_C_BINARY;
+            b.width = length;
+            break;
+        case QVariant::String:
+            if (length <= 0 || length > MAXBOUNDCOLSIZE) {
+                b.bound = false;
+                break;
+            }
+            if (unicode) {
+                b.cType = SQL_C_TCHAR;
+                b.width = (length * (sizeof(SQLTCHAR) == 1 ? 3 : 1) + 1) * sizeof(SQLTCHAR);
+            } else {
+                b.cType = SQL_C_CHAR;
+                b.width = length * 3 + 1;
+            }
+            break;
+        case QVariant::Double:
+            switch (policy) {
+            case QSql::LowPrecisionInt32:
+                b.type = QVariant::Int;
+                b.cType = SQL_C_SLONG;
+                b.width = sizeof(SQLINTEGER);
+                break;
+            case QSql::LowPrecisionInt64:
+                b.type = QVariant::LongLong;
+                b.cType = SQL_C_SBIGINT;
+                b.width = sizeof(SQLBIGINT);
+                break;
+            case QSql::LowPrecisionDouble:
+                b.cType = SQL_C_DOUBLE;
+                b.width = sizeof(SQLDOUBLE);
+                break;
+            case QSql::HighPrecision:
+                if (length <= 0 || length > MAXBOUNDCOLSIZE) {
+                    b.bound = false;
+                    break;
+                }
+                // room for sign, decimal point, exponent and the 0 termination
+                b.type = QVariant::String;
+                b.cType = SQL_C_CHAR;
+                b.width = length + 8;
+                break;
+            }
+            break;
+        default:
+            b.bound = false;
+            break;
+        }
+        if (!b.bound) {
+            if (!getDataBlock)
+                return false;
+            if (firstUnbound == -1)
+                firstUnbound = i;
+            continue;
+        }
+        lastBound = i;
+        // keep every row of every column suitably aligned
+        b.width = (b.width + 7) & ~SQLLEN(7);
+        rowSize += b.width + SQLLEN(sizeof(SQLLEN));
+    }
+
+    // without SQL_GD_ANY_COLUMN only the columns after the last bound one can be read with SQLGetData()
+    if (lastBound == -1)
+        return false;
+    if (firstUnbound != -1 && firstUnbound < lastBound && !(getDataExtensions & SQL_GD_ANY_COLUMN))
+        return false;
+
+    const SQLULEN rowArraySize = SQLULEN(qBound(1, int(MAXROWSETBYTES / rowSize), ROWARRAYSIZE));
+    if (rowArraySize < 2)
+        return false;
+
+    columnBuffers.swap(buffers);
+    blockCursor = true;
+
+    SQLRETURN r = SQLSetStmtAttr(hStmt,
+                                 SQL_ATTR_ROW_BIND_TYPE,
+                                 (SQLPOINTER)SQL_BIND_BY_COLUMN,
+                                 SQL_IS_UINTEGER);
+    if (r == SQL_SUCCESS)
+        r = SQLSetStmtAttr(hStmt,
+                           SQL_ATTR_ROW_ARRAY_SIZE,
+                           (SQLPOINTER)rowArraySize,
+                           SQL_IS_UINTEGER);
+    if (r == SQL_SUCCESS)
+        r = SQLSetStmtAttr(hStmt,
+                           SQL_ATTR_ROWS_FETCHED_PTR,
+                           &rowsFetched,
+                           0);
+    for (int i = 0; r == SQL_SUCCESS && i < columnBuffers.count(); ++i) {
+        ColumnBuffer &b = columnBuffers[i];
+        if (!b.bound)
+            continue;
+        b.data.resize(int(b.width * rowArraySize));
+        b.indicators.resize(int(rowArraySize));
+        r = SQLBindCol(hStmt,
+                       i + 1,
+                       b.cType,
+                       (SQLPOINTER)b.data.data(),
+                       b.width,
+                       b.indicators.data());
+    }
+    if (r != SQL_SUCCESS) {
+        qSqlWarning(QLatin1String("QODBCResult: Unable to bind columns, using single row fetch"), this);
+        unbindColumns();
+        return false;
+    }
+    return true;
+}
+
+void QODBCResultPrivate::unbindColumns()
+{
+    if (blockCursor && hStmt && isStmtHandleValid()) {
+        SQLFreeStmt(hStmt, SQL_UNBIND);
+        SQLSetStmtAttr(hStmt, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)1, SQL_IS_UINTEGER);
+        SQLSetStmtAttr(hStmt, SQL_ATTR_ROWS_FETCHED_PTR, nullptr, 0);
+    }
+    columnBuffers.clear();
+    rowsFetched = 0;
+    rowsetPos = 0;
+    blockCursor = false;
+    rowsetPositioned = false;
+}
+
+QVariant QODBCResultPrivate::boundValue(int field) const
+{
+    const ColumnBuffer &b = columnBuffers.at(field);
+    const SQLLEN ind = b.indicators.at(int(rowsetPos));
+    if (ind == SQL_NULL_DATA)
+        return QVariant(b.type);
+
+    const char *p = b.data.constData() + rowsetPos * b.width;
+    const bool truncated = isTruncated(field);
+
+    if (unicode && b.cType == SQL_C_TCHAR) {
+        SQLLEN len = truncated ? b.width - SQLLEN(sizeof(SQLTCHAR)) : ind;
+        return fromSQLTCHAR(reinterpret_cast<const SQLTCHAR *>(p), int(len / sizeof(SQLTCHAR)));
+    }
+
+    switch (b.cType) {
+    case SQL_C_SLONG:
+        return int(*reinterpret_cast<const SQLINTEGER *>(p));
+    case SQL_C_ULONG:
+        return uint(*reinterpret_cast<const SQLUINTEGER *>(p));
+    case SQL_C_SBIGINT:
+        return qint64(*reinterpret_cast<const SQLBIGINT *>(p));
+    case SQL_C_UBIGINT:
+        return quint64(*reinterpret_cast<const SQLUBIGINT *>(p));
+    case SQL_C_DOUBLE:
+        return double(*reinterpret_cast<const SQLDOUBLE *>(p));
+    case SQL_C_DATE: {
+        const DATE_STRUCT *dbuf = reinterpret_cast<const DATE_STRUCT *>(p);
+        return QVariant(QDate(dbuf->year, dbuf->month, dbuf->day)); }
+    case SQL_C_TIME: {
+        const TIME_STRUCT *tbuf = reinterpret_cast<const TIME_STRUCT *>(p);
+        return QVariant(QTime(tbuf->hour, tbuf->minute, tbuf->second)); }
+    case SQL_C_TIMESTAMP: {
+        const TIMESTAMP_STRUCT *dtbuf = reinterpret_cast<const TIMESTAMP_STRUCT *>(p);
+        return QVariant(QDateTime(QDate(dtbuf->year, dtbuf->month, dtbuf->day),
+                        QTime(dtbuf->hour, dtbuf->minute, dtbuf->second, dtbuf->fraction / 1000000))); }
+    case SQL_C_BINARY:
+        return QByteArray(p, int(truncated ? b.width : ind));
+    case SQL_C_CHAR: {
+        int len = int(truncated ? b.width - 1 : ind);
+        // Remove any trailing \0 as some drivers misguidedly append one
+        if (len > 0 && p[len - 1] == 0)
+            len--;
+        return QString::fromUtf8(p, len); }
+    default:
+        return QVariant();
+    }
+}
+
+bool QODBCResultPrivate::isTruncated(int field) const
+{
+    const ColumnBuffer &b = columnBuffers.at(field);
+    if (!b.bound)
+        return false;
+    const SQLLEN ind = b.indicators.at(int(rowsetPos));
+    if (ind == SQL_NULL_DATA)
+        return false;
+    // SQL_NO_TOTAL or a length past the buffer means the value was truncated,
+    // character buffers also need room for the 0 termination
+    const bool character = b.cType == SQL_C_TCHAR || b.cType == SQL_C_CHAR;
+    return ind == SQL_NO_TOTAL || (character ? ind >= b.width : ind > b.width);
+}
+
+bool QODBCResultPrivate::needsGetData(int field) const
+{
+    return !columnBuffers.at(field).bound || isTruncated(field);
+}
+
+QVariant QODBCResultPrivate::rowsetValue(int field, QSql::NumericalPrecisionPolicy policy)
+{
+    // SQLGetData() can't return a column twice or go back to an earlier
+    // column, so every column of the row that needs it up to field is read
+    // in order and cached until the next fetch
+    for (int i = fieldCacheIdx; i <= field; ++i) {
+        if (!needsGetData(i))
+            continue;
+        const ColumnBuffer &b = columnBuffers.at(i);
+        const bool canGetData = (getDataExtensions & SQL_GD_BLOCK)
+                && (!b.bound || (getDataExtensions & SQL_GD_BOUND));
+        if (canGetData && !rowsetPositioned) {
+            SQLRETURN r = SQLSetPos(hStmt, SQLSETPOSIROW(rowsetPos + 1), SQL_POSITION, SQL_LOCK_NO_CHANGE);
+            rowsetPositioned = r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO;
+            if (!rowsetPositioned)
+                qSqlWarning(QLatin1String("QODBCResult::data: Unable to position the rowset"), this);
+        }
+        if (canGetData && rowsetPositioned) {
+            fieldCache[i] = getData(i, policy);
+        } else if (b.bound) {
+            qWarning("QODBCResult::data: column %d was truncated to %d bytes", i, int(b.width));
+            fieldCache[i] = boundValue(i);
+        } else {
+            fieldCache[i] = QVariant(b.type);
+        }
+    }
+    fieldCacheIdx = qMax(fieldCacheIdx, field + 1);
+    return fieldCache.at(field);
+}
+
+bool QODBCResultPrivate::isBoundNull(int field) const
+{
+    return columnBuffers.at(field).indicators.at(int(rowsetPos)) == SQL_NULL_DATA;
+}
+
+SQLHANDLE QODBCDriverPrivate::takeCachedStatement(const QString &query, bool forwardOnly)
+{
+    for (int i = 0; i < statementCache.count(); ++i) {
+        const CachedStatement &stmt = statementCache.at(i);
+        if (stmt.forwardOnly == forwardOnly && stmt.query == query)
+            return statementCache.takeAt(i).hStmt;
+    }
+    return nullptr;
+}
+
+void QODBCDriverPrivate::cacheStatement(SQLHANDLE hStmt, const QString &query, bool forwardOnly)
+{
+    // Close any open cursor and drop parameter and column bindings,
+    // the prepared statement itself stays on the server.
+    SQLFreeStmt(hStmt, SQL_CLOSE);
+    SQLFreeStmt(hStmt, SQL_RESET_PARAMS);
+    SQLFreeStmt(hStmt, SQL_UNBIND);
+
+    statementCache.prepend(CachedStatement{hStmt, forwardOnly, query});
+    while (statementCache.count() > STMTCACHESIZE) {
+        SQLRETURN r = SQLFreeHandle(SQL_HANDLE_STMT, statementCache.takeLast().hStmt);
+        if (r != SQL_SUCCESS)
+            qSqlWarning(QLatin1String("QODBCDriver: Unable to free cached statement handle ")
+                         + QString::number(r), this);
+    }
+}
+
 static size_t qGetODBCVersion(const QString &connOpts)
 {
     if (connOpts.contains(QLatin1String("SQL_ATTR_ODBC_VERSION=SQL_OV_ODBC3"), Qt::CaseInsensitive))
@@ -972,10 +1587,10 @@ QODBCResult::~QODBCResult()
 {
     Q_D(QODBCResult);
     if (d->hStmt && d->isStmtHandleValid() && driver() && driver()->isOpen()) {
-        SQLRETURN r = SQLFreeHandle(SQL_HANDLE_STMT, d->hStmt);
-        if (r != SQL_SUCCESS)
-            qSqlWarning(QLatin1String("QODBCDriver: Unable to free statement handle ")
-                         + QString::number(r), d);
+        d->finishStatement();
+        d->unbindColumns();
+        if (!d->releaseStatement())
+            qSqlWarning(QLatin1String("QODBCDriver: Unable to free statement handle"), d);
     }
 }
 
@@ -987,16 +1602,15 @@ bool QODBCResult::reset (const QString& query)
     d->rInf.clear();
     d->fieldCache.clear();
     d->fieldCacheIdx = 0;
+    d->finishStatement();
+    d->unbindColumns();
 
     // Always reallocate the statement handle - the statement attributes
     // are not reset if SQLFreeStmt() is called which causes some problems.
     SQLRETURN r;
-    if (d->hStmt && d->isStmtHandleValid()) {
-        r = SQLFreeHandle(SQL_HANDLE_STMT, d->hStmt);
-        if (r != SQL_SUCCESS) {
-            qSqlWarning(QLatin1String("QODBCResult::reset: Unable to free statement handle"), d);
-            return false;
-        }
+    if (!d->releaseStatement()) {
+        qSqlWarning(QLatin1String("QODBCResult::reset: Unable to free statement handle"), d);
+        return false;
     }
     r  = SQLAllocHandle(SQL_HANDLE_STMT,
                          d->dpDbc(),
@@ -1026,9 +1640,14 @@ bool QODBCResult::reset (const QString& query)
         return false;
     }
 
+    QElapsedTimer timer;
+    timer.start();
+    d->setExecuting(true);
     r = SQLExecDirect(d->hStmt,
                        toSQLTCHAR(query).data(),
                        (SQLINTEGER) query.length());
+    d->setExecuting(false);
+    d->addExecute(timer.nsecsElapsed(), r);
     if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO && r!= SQL_NO_DATA) {
         setLastError(qMakeError(QCoreApplication::translate("QODBCResult",
                      "Unable to execute statement"), QSqlError::StatementError, d));
@@ -1048,6 +1667,8 @@ bool QODBCResult::reset (const QString& query)
             d->rInf.append(qMakeFieldInfo(d, i));
         }
         d->fieldCache.resize(count);
+        if (isForwardOnly())
+            d->bindColumns(numericalPrecisionPolicy());
     } else {
         setSelect(false);
     }
@@ -1079,9 +1700,12 @@ bool QODBCResult::fetch(int i)
             ok = fetchNext();
         return ok;
     } else {
+        QElapsedTimer timer;
+        timer.start();
         r = SQLFetchScroll(d->hStmt,
                             SQL_FETCH_ABSOLUTE,
                             actualIdx);
+        d->addFetch(timer.nsecsElapsed(), r);
     }
     if (r != SQL_SUCCESS) {
         if (r != SQL_NO_DATA)
@@ -1089,6 +1713,7 @@ bool QODBCResult::fetch(int i)
                 "Unable to fetch"), QSqlError::ConnectionError, d));
         return false;
     }
+    d->addRows(1, 0);
     setAt(i);
     return true;
 }
@@ -1099,12 +1724,21 @@ bool QODBCResult::fetchNext()
     SQLRETURN r;
     d->clearValues();
 
+    // Serve rows from the bound rowset, fetch the next rowset once it is used up
+    if (d->blockCursor && ++d->rowsetPos < d->rowsFetched) {
+        setAt(at() + 1);
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
     if (d->hasSQLFetchScroll)
         r = SQLFetchScroll(d->hStmt,
                            SQL_FETCH_NEXT,
                            0);
     else
         r = SQLFetch(d->hStmt);
+    d->addFetch(timer.nsecsElapsed(), r);
 
     if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO) {
         if (r != SQL_NO_DATA)
@@ -1112,6 +1746,21 @@ bool QODBCResult::fetchNext()
                 "Unable to fetch next"), QSqlError::ConnectionError, d));
         return false;
     }
+    if (d->blockCursor) {
+        d->rowsetPos = 0;
+        if (d->rowsFetched == 0)
+            return false;
+        qint64 bytes = 0;
+        for (const QODBCResultPrivate::ColumnBuffer &b : qAsConst(d->columnBuffers)) {
+            if (!b.bound)
+                continue;
+            for (SQLULEN row = 0; row < d->rowsFetched; ++row)
+                bytes += qMax(SQLLEN(0), b.indicators.at(int(row)));
+        }
+        d->addRows(qint64(d->rowsFetched), bytes);
+    } else {
+        d->addRows(1, 0);
+    }
     setAt(at() + 1);
     return true;
 }
@@ -1127,10 +1776,13 @@ bool QODBCResult::fetchFirst()
         return fetchNext();
     }
 
+    QElapsedTimer timer;
+    timer.start();
     if (d->hasSQLFetchScroll && !d->isFreeTDSDriver)
         r = SQLFetchScroll(d->hStmt, SQL_FETCH_FIRST, 0);
     else
         r = SQLFetch(d->hStmt);
+    d->addFetch(timer.nsecsElapsed(), r);
 
     if (r != SQL_SUCCESS) {
         if (r != SQL_NO_DATA)
@@ -1138,6 +1790,7 @@ bool QODBCResult::fetchFirst()
                 "Unable to fetch first"), QSqlError::ConnectionError, d));
         return false;
     }
+    d->addRows(1, 0);
     setAt(0);
     return true;
 }
@@ -1150,10 +1803,13 @@ bool QODBCResult::fetchPrevious()
     SQLRETURN r;
     d->clearValues();
 
+    QElapsedTimer timer;
+    timer.start();
     if (d->hasSQLFetchScroll)
         r = SQLFetchScroll(d->hStmt, SQL_FETCH_PRIOR, 0);
     else
         r = SQLFetch(d->hStmt);
+    d->addFetch(timer.nsecsElapsed(), r);
 
     if (r != SQL_SUCCESS) {
         if (r != SQL_NO_DATA)
@@ -1161,6 +1817,7 @@ bool QODBCResult::fetchPrevious()
                 "Unable to fetch previous"), QSqlError::ConnectionError, d));
         return false;
     }
+    d->addRows(1, 0);
     setAt(at() - 1);
     return true;
 }
@@ -1184,10 +1841,13 @@ bool QODBCResult::fetchLast()
         return true;
     }
 
+    QElapsedTimer timer;
+    timer.start();
   if (d->hasSQLFetchScroll)
       r = SQLFetchScroll(d->hStmt, SQL_FETCH_LAST, 0);
   else
       r = SQLFetch(d->hStmt);
+    d->addFetch(timer.nsecsElapsed(), r);
 
     if (r != SQL_SUCCESS) {
         if (r != SQL_NO_DATA)
@@ -1203,10 +1863,100 @@ bool QODBCResult::fetchLast()
                         0);
     if (r != SQL_SUCCESS)
         return false;
+    d->addRows(1, 0);
     setAt(currRow-1);
     return true;
 }
 
+QVariant QODBCResultPrivate::getData(int field, QSql::NumericalPrecisionPolicy policy)
+{
+    SQLRETURN r(0);
+    SQLLEN lengthIndicator = 0;
+    QVariant value;
+    const QSqlField info = rInf.field(field);
+    switch (info.type()) {
+    case QVariant::LongLong:
+        value = qGetBigIntData(hStmt, field);
+    break;
+    case QVariant::ULongLong:
+        value = qGetBigIntData(hStmt, field, false);
+        break;
+    case QVariant::Int:
+        value = qGetIntData(hStmt, field);
+    break;
+    case QVariant::UInt:
+        value = qGetIntData(hStmt, field, false);
+        break;
+    case QVariant::Date:
+        DATE_STRUCT dbuf;
+        r = SQLGetData(hStmt,
+                        field + 1,
+                        SQL_C_DATE,
+                        (SQLPOINTER)&dbuf,
+                        0,
+                        &lengthIndicator);
+        if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && (lengthIndicator != SQL_NULL_DATA))
+            value = QVariant(QDate(dbuf.year, dbuf.month, dbuf.day));
+        else
+            value = QVariant(QVariant::Date);
+    break;
+    case QVariant::Time:
+        TIME_STRUCT tbuf;
+        r = SQLGetData(hStmt,
+                        field + 1,
+                        SQL_C_TIME,
+                        (SQLPOINTER)&tbuf,
+                        0,
+                        &lengthIndicator);
+        if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && (lengthIndicator != SQL_NULL_DATA))
+            value = QVariant(QTime(tbuf.hour, tbuf.minute, tbuf.second));
+        else
+            value = QVariant(QVariant::Time);
+    break;
+    case QVariant::DateTime:
+        TIMESTAMP_STRUCT dtbuf;
+        r = SQLGetData(hStmt,
+                        field + 1,
+                        SQL_C_TIMESTAMP,
+                        (SQLPOINTER)&dtbuf,
+                        0,
+                        &lengthIndicator);
+        if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && (lengthIndicator != SQL_NULL_DATA))
+            value = QVariant(QDateTime(QDate(dtbuf.year, dtbuf.month, dtbuf.day),
+                   QTime(dtbuf.hour, dtbuf.minute, dtbuf.second, dtbuf.fraction / 1000000)));
+        else
+            value = QVariant(QVariant::DateTime);
+        break;
+    case QVariant::ByteArray:
+        value = qGetBinaryData(hStmt, field);
+        break;
+    case QVariant::String:
+        value = qGetStringData(hStmt, field, info.length(), unicode, &stringBuffer);
+        break;
+    case QVariant::Double:
+        switch(policy) {
+            case QSql::LowPrecisionInt32:
+                value = qGetIntData(hStmt, field);
+                break;
+            case QSql::LowPrecisionInt64:
+                value = qGetBigIntData(hStmt, field);
+                break;
+            case QSql::LowPrecisionDouble:
+                value = qGetDoubleData(hStmt, field);
+                break;
+            case QSql::HighPrecision:
+                value = qGetStringData(hStmt, field, info.length(), false, &stringBuffer);
+                break;
+        }
+        break;
+    default:
+        value = QVariant(qGetStringData(hStmt, field, info.length(), false, &stringBuffer));
+        break;
+    }
+    addRows(0, qValueSize(value));
+    return value;
+}
+
 QVariant QODBCResult::data(int field)
 {
     Q_D(QODBCResult);
@@ -1214,95 +1964,18 @@ QVariant QODBCResult::data(int field)
         qWarning() << "QODBCResult::data: column" << field << "out of range";
         return QVariant();
     }
+    if (d->blockCursor) {
+        if (!d->needsGetData(field))
+            return d->boundValue(field);
+        return d->rowsetValue(field, numericalPrecisionPolicy());
+    }
     if (field < d->fieldCacheIdx)
         return d->fieldCache.at(field);
 
-    SQLRETURN r(0);
-    SQLLEN lengthIndicator = 0;
-
     for (int i = d->fieldCacheIdx; i <= field; ++i) {
         // some servers do not support fetching column n after we already
         // fetched column n+1, so cache all previous columns here
-        const QSqlField info = d->rInf.field(i);
-        switch (info.type()) {
-        case QVariant::LongLong:
-            d->fieldCache[i] = qGetBigIntData(d->hStmt, i);
-        break;
-        case QVariant::ULongLong:
-            d->fieldCache[i] = qGetBigIntData(d->hStmt, i, false);
-            break;
-        case QVariant::Int:
-            d->fieldCache[i] = qGetIntData(d->hStmt, i);
-        break;
-        case QVariant::UInt:
-            d->fieldCache[i] = qGetIntData(d->hStmt, i, false);
-            break;
-        case QVariant::Date:
-            DATE_STRUCT dbuf;
-            r = SQLGetData(d->hStmt,
-                            i + 1,
-                            SQL_C_DATE,
-                            (SQLPOINTER)&dbuf,
-                            0,
-                            &lengthIndicator);
-            if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && (lengthIndicator != SQL_NULL_DATA))
-                d->fieldCache[i] = QVariant(QDate(dbuf.year, dbuf.month, dbuf.day));
-            else
-                d->fieldCache[i] = QVariant(QVariant::Date);
-        break;
-        case QVariant::Time:
-            TIME_STRUCT tbuf;
-            r = SQLGetData(d->hStmt,
-                            i + 1,
-                            SQL_C_TIME,
-                            (SQLPOINTER)&tbuf,
-                            0,
-                            &lengthIndicator);
-            if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && (lengthIndicator != SQL_NULL_DATA))
-                d->fieldCache[i] = QVariant(QTime(tbuf.hour, tbuf.minute, tbuf.second));
-            else
-                d->fieldCache[i] = QVariant(QVariant::Time);
-        break;
-        case QVariant::DateTime:
-            TIMESTAMP_STRUCT dtbuf;
-            r = SQLGetData(d->hStmt,
-                            i + 1,
-                            SQL_C_TIMESTAMP,
-                            (SQLPOINTER)&dtbuf,
-                            0,
-                            &lengthIndicator);
-            if ((r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) && (lengthIndicator != SQL_NULL_DATA))
-                d->fieldCache[i] = QVariant(QDateTime(QDate(dtbuf.year, dtbuf.month, dtbuf.day),
-                       QTime(dtbuf.hour, dtbuf.minute, dtbuf.second, dtbuf.fraction / 1000000)));
-            else
-                d->fieldCache[i] = QVariant(QVariant::DateTime);
-            break;
-        case QVariant::ByteArray:
-            d->fieldCache[i] = qGetBinaryData(d->hStmt, i);
-            break;
-        case QVariant::String:
-            d->fieldCache[i] = qGetStringData(d->hStmt, i, info.length(), d->unicode);
-            break;
-        case QVariant::Double:
-            switch(numericalPrecisionPolicy()) {
-                case QSql::LowPrecisionInt32:
-                    d->fieldCache[i] = qGetIntData(d->hStmt, i);
-                    break;
-                case QSql::LowPrecisionInt64:
-                    d->fieldCache[i] = qGetBigIntData(d->hStmt, i);
-                    break;
-                case QSql::LowPrecisionDouble:
-                    d->fieldCache[i] = qGetDoubleData(d->hStmt, i);
-                    break;
-                case QSql::HighPrecision:
-                    d->fieldCache[i] = qGetStringData(d->hStmt, i, info.length(), false);
-                    break;
-            }
-            break;
-        default:
-            d->fieldCache[i] = QVariant(qGetStringData(d->hStmt, i, info.length(), false));
-            break;
-        }
+        d->fieldCache[i] = d->getData(i, numericalPrecisionPolicy());
         d->fieldCacheIdx = field + 1;
     }
     return d->fieldCache[field];
@@ -1313,6 +1986,8 @@ bool QODBCResult::isNull(int field)
     Q_D(const QODBCResult);
     if (field < 0 || field >= d->fieldCache.size())
         return true;
+    if (d->blockCursor)
+        return d->columnBuffers.at(field).bound ? d->isBoundNull(field) : data(field).isNull();
     if (field <= d->fieldCacheIdx) {
         // since there is no good way to find out whether the value is NULL
         // without fetching the field we'll fetch it here.
@@ -1347,13 +2022,26 @@ bool QODBCResult::prepare(const QString& query)
     SQLRETURN r;
 
     d->rInf.clear();
-    if (d->hStmt && d->isStmtHandleValid()) {
-        r = SQLFreeHandle(SQL_HANDLE_STMT, d->hStmt);
-        if (r != SQL_SUCCESS) {
-            qSqlWarning(QLatin1String("QODBCResult::prepare: Unable to close statement"), d);
-            return false;
+    d->finishStatement();
+    d->unbindColumns();
+    if (!d->releaseStatement()) {
+        qSqlWarning(QLatin1String("QODBCResult::prepare: Unable to close statement"), d);
+        return false;
+    }
+
+    // Reuse a handle this connection already prepared with the same SQL
+    QODBCDriverPrivate *dd = const_cast<QODBCDriverPrivate *>(d->drv_d_func());
+    if (dd) {
+        d->hStmt = dd->takeCachedStatement(query, isForwardOnly());
+        if (d->hStmt) {
+            dd->stats.cachedPrepares++;
+            d->updateStmtHandleState();
+            d->preparedQuery = query;
+            d->preparedForwardOnly = isForwardOnly();
+            return true;
         }
     }
+
     r  = SQLAllocHandle(SQL_HANDLE_STMT,
                          d->dpDbc(),
                          &d->hStmt);
@@ -1382,15 +2070,20 @@ bool QODBCResult::prepare(const QString& query)
         return false;
     }
 
+    QElapsedTimer timer;
+    timer.start();
     r = SQLPrepare(d->hStmt,
                     toSQLTCHAR(query).data(),
                     (SQLINTEGER) query.length());
+    d->addPrepare(timer.nsecsElapsed(), r);
 
     if (r != SQL_SUCCESS) {
         setLastError(qMakeError(QCoreApplication::translate("QODBCResult",
                      "Unable to prepare statement"), QSqlError::StatementError, d));
         return false;
     }
+    d->preparedQuery = query;
+    d->preparedForwardOnly = isForwardOnly();
     return true;
 }
 
@@ -1410,22 +2103,28 @@ bool QODBCResult::exec()
 
     if (isSelect())
         SQLCloseCursor(d->hStmt);
+    d->finishStatement();
+    d->unbindColumns();
 
     QVector<QVariant>& values = boundValues();
-    QVector<QByteArray> tmpStorage(values.count(), QByteArray()); // holds temporary buffers
-    QVarLengthArray<SQLLEN, 32> indicators(values.count());
-    memset(indicators.data(), 0, indicators.size() * sizeof(SQLLEN));
+    // parameter buffers are kept with the prepared statement, input values
+    // that didn't change since the last exec() are still bound
+    d->resizeParams(values.count());
+    QVector<QByteArray> &tmpStorage = d->paramStorage;
 
     // bind parameters - only positional binding allowed
     int i;
     SQLRETURN r;
     for (i = 0; i < values.count(); ++i) {
-        if (bindValueType(i) & QSql::Out)
+        const bool isOut = bindValueType(i) & QSql::Out;
+        if (isOut)
             values[i].detach();
         const QVariant &val = values.at(i);
-        SQLLEN *ind = &indicators[i];
-        if (val.isNull())
-            *ind = SQL_NULL_DATA;
+        if (!isOut && d->isParamBound(i, val))
+            continue;
+        d->paramValues[i] = QVariant();
+        SQLLEN *ind = &d->paramIndicators[i];
+        *ind = val.isNull() ? SQL_NULL_DATA : 0;
         switch (val.userType()) {
             case QVariant::Date: {
                 QByteArray &ba = tmpStorage[i];
@@ -1509,7 +2208,7 @@ bool QODBCResult::exec()
                                       SQL_INTEGER,
                                       0,
                                       0,
-                                      const_cast<void *>(val.constData()),
+                                      qParamData(tmpStorage[i], val, isOut),
                                       0,
                                       *ind == SQL_NULL_DATA ? ind : NULL);
                 break;
@@ -1521,7 +2220,7 @@ bool QODBCResult::exec()
                                       SQL_NUMERIC,
                                       15,
                                       0,
-                                      const_cast<void *>(val.constData()),
+                                      qParamData(tmpStorage[i], val, isOut),
                                       0,
                                       *ind == SQL_NULL_DATA ? ind : NULL);
                 break;
@@ -1533,7 +2232,7 @@ bool QODBCResult::exec()
                                       SQL_DOUBLE,
                                       0,
                                       0,
-                                      const_cast<void *>(val.constData()),
+                                      qParamData(tmpStorage[i], val, isOut),
                                       0,
                                       *ind == SQL_NULL_DATA ? ind : NULL);
                 break;
@@ -1545,7 +2244,7 @@ bool QODBCResult::exec()
                                       SQL_BIGINT,
                                       0,
                                       0,
-                                      const_cast<void *>(val.constData()),
+                                      qParamData(tmpStorage[i], val, isOut),
                                       0,
                                       *ind == SQL_NULL_DATA ? ind : NULL);
                 break;
@@ -1557,25 +2256,27 @@ bool QODBCResult::exec()
                                       SQL_BIGINT,
                                       0,
                                       0,
-                                      const_cast<void *>(val.constData()),
+                                      qParamData(tmpStorage[i], val, isOut),
                                       0,
                                       *ind == SQL_NULL_DATA ? ind : NULL);
                 break;
-            case QVariant::ByteArray:
+            case QVariant::ByteArray: {
+                QByteArray &ba = tmpStorage[i];
+                ba = val.toByteArray();
                 if (*ind != SQL_NULL_DATA) {
-                    *ind = val.toByteArray().size();
+                    *ind = ba.size();
                 }
                 r = SQLBindParameter(d->hStmt,
                                       i + 1,
                                       qParamType[bindValueType(i) & QSql::InOut],
                                       SQL_C_BINARY,
                                       SQL_LONGVARBINARY,
-                                      val.toByteArray().size(),
+                                      ba.size(),
                                       0,
-                                      const_cast<char *>(val.toByteArray().constData()),
-                                      val.toByteArray().size(),
+                                      const_cast<char *>(ba.constData()),
+                                      ba.size(),
                                       ind);
-                break;
+                break; }
             case QVariant::Bool:
                 r = SQLBindParameter(d->hStmt,
                                       i + 1,
@@ -1584,7 +2285,7 @@ bool QODBCResult::exec()
                                       SQL_BIT,
                                       0,
                                       0,
-                                      const_cast<void *>(val.constData()),
+                                      qParamData(tmpStorage[i], val, isOut),
                                       0,
                                       *ind == SQL_NULL_DATA ? ind : NULL);
                 break;
@@ -1611,7 +2312,15 @@ bool QODBCResult::exec()
                                             ind);
                         break;
                     }
-                    ba = QByteArray ((const char *)toSQLTCHAR(str).constData(), str.size()*sizeof(SQLTCHAR));
+                    // UTF-16 is bound in place, paramValues keeps the string data alive
+                    const char *data;
+                    if (sizeof(SQLTCHAR) == 2) {
+                        ba.clear();
+                        data = reinterpret_cast<const char *>(str.constData());
+                    } else {
+                        ba = QByteArray ((const char *)toSQLTCHAR(str).constData(), strSize);
+                        data = ba.constData();
+                    }
                     r = SQLBindParameter(d->hStmt,
                                           i + 1,
                                           qParamType[bindValueType(i) & QSql::InOut],
@@ -1619,8 +2328,8 @@ bool QODBCResult::exec()
                                           strSize > 254 ? SQL_WLONGVARCHAR : SQL_WVARCHAR,
                                           strSize,
                                           0,
-                                          const_cast<char *>(ba.constData()),
-                                          ba.size(),
+                                          const_cast<char *>(data),
+                                          strSize,
                                           ind);
                     break;
                 }
@@ -1647,6 +2356,7 @@ bool QODBCResult::exec()
             // fall through
             default: {
                 QByteArray &ba = tmpStorage[i];
+                ba.clear();
                 if (*ind != SQL_NULL_DATA)
                     *ind = ba.size();
                 r = SQLBindParameter(d->hStmt,
@@ -1667,8 +2377,15 @@ bool QODBCResult::exec()
                          "Unable to bind variable"), QSqlError::StatementError, d));
             return false;
         }
+        if (!isOut)
+            d->paramValues[i] = val;
     }
+    QElapsedTimer timer;
+    timer.start();
+    d->setExecuting(true);
     r = SQLExecute(d->hStmt);
+    d->setExecuting(false);
+    d->addExecute(timer.nsecsElapsed(), r);
     if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO && r != SQL_NO_DATA) {
         qWarning() << "QODBCResult::exec: Unable to execute statement:" << qODBCWarn(d);
         setLastError(qMakeError(QCoreApplication::translate("QODBCResult",
@@ -1689,6 +2406,8 @@ bool QODBCResult::exec()
             d->rInf.append(qMakeFieldInfo(d, i));
         }
         d->fieldCache.resize(count);
+        if (isForwardOnly())
+            d->bindColumns(numericalPrecisionPolicy());
     } else {
         setSelect(false);
     }
@@ -1740,12 +2459,222 @@ bool QODBCResult::exec()
                     values[i] = tmpStorage.at(i);
                 break; }
         }
-        if (indicators[i] == SQL_NULL_DATA)
+        if (d->paramIndicators[i] == SQL_NULL_DATA)
             values[i] = QVariant(QVariant::Type(values[i].userType()));
     }
     return true;
 }
 
+// Executes the statement once for all rows using column-wise parameter
+// arrays (SQL_ATTR_PARAMSET_SIZE). Falls back to one exec() per row for
+// output parameters and types that can't be bound as arrays.
+bool QODBCResult::execBatch(bool arrayBind)
+{
+    Q_D(QODBCResult);
+    QVector<QVariant> &values = boundValues();
+    if (!d->hStmt || values.isEmpty())
+        return QSqlResult::execBatch(arrayBind);
+
+    struct ParamArray {
+        SQLSMALLINT cType = SQL_C_CHAR;
+        SQLSMALLINT sqlType = SQL_VARCHAR;
+        SQLULEN colSize = 1;
+        SQLLEN width = 1;
+        QByteArray data;
+        QVector<SQLLEN> indicators;
+    };
+    QVector<ParamArray> arrays(values.count());
+    int rows = -1;
+
+    for (int i = 0; i < values.count(); ++i) {
+        if ((bindValueType(i) & QSql::Out) || values.at(i).userType() != QVariant::List)
+            return QSqlResult::execBatch(arrayBind);
+        const QVariantList list = values.at(i).toList();
+        if (rows == -1)
+            rows = list.count();
+        if (list.count() != rows || rows == 0)
+            return QSqlResult::execBatch(arrayBind);
+
+        int type = QVariant::Invalid;
+        for (const QVariant &val : list) {
+            if (val.isNull())
+                continue;
+            if (type == QVariant::Invalid)
+                type = val.userType();
+            else if (val.userType() != type)
+                return QSqlResult::execBatch(arrayBind);
+        }
+
+        ParamArray &a = arrays[i];
+        QVector<QByteArray> encoded;
+        switch (type) {
+        case QVariant::Int:
+            a.cType = SQL_C_SLONG;
+            a.sqlType = SQL_INTEGER;
+            a.width = sizeof(SQLINTEGER);
+            break;
+        case QVariant::LongLong:
+            a.cType = SQL_C_SBIGINT;
+            a.sqlType = SQL_BIGINT;
+            a.width = sizeof(SQLBIGINT);
+            break;
+        case QVariant::Double:
+            a.cType = SQL_C_DOUBLE;
+            a.sqlType = SQL_DOUBLE;
+            a.width = sizeof(SQLDOUBLE);
+            break;
+        case QVariant::Bool:
+            a.cType = SQL_C_BIT;
+            a.sqlType = SQL_BIT;
+            a.width = sizeof(SQLCHAR);
+            break;
+        case QVariant::Invalid:
+        case QVariant::String:
+        case QVariant::ByteArray:
+            // variable length values are padded to the longest one
+            encoded.resize(rows);
+            a.width = 0;
+            for (int row = 0; row < rows; ++row) {
+                const QVariant &val = list.at(row);
+                if (val.isNull())
+                    continue;
+                if (type == QVariant::ByteArray) {
+                    encoded[row] = val.toByteArray();
+                } else if (d->unicode) {
+                    const QVarLengthArray<SQLTCHAR> str(toSQLTCHAR(val.toString()));
+                    encoded[row] = QByteArray((const char *)str.constData(), (str.size() - 1) * sizeof(SQLTCHAR));
+                } else {
+                    encoded[row] = val.toString().toUtf8();
+                }
+                a.width = qMax(a.width, SQLLEN(encoded.at(row).size()));
+            }
+            // empty or null columns still get room for one character, and
+            // wide characters keep every row of the array aligned
+            if (type == QVariant::ByteArray) {
+                a.cType = SQL_C_BINARY;
+                a.width = qMax(a.width, SQLLEN(1));
+                a.sqlType = a.width > 8000 ? SQL_LONGVARBINARY : SQL_VARBINARY;
+                a.colSize = a.width;
+            } else if (d->unicode) {
+                a.cType = SQL_C_TCHAR;
+                a.colSize = qMax(SQLULEN(1), SQLULEN((a.width + sizeof(SQLTCHAR) - 1) / sizeof(SQLTCHAR)));
+                a.sqlType = a.colSize > 4000 ? SQL_WLONGVARCHAR : SQL_WVARCHAR;
+                a.width = SQLLEN((a.colSize + 1) * sizeof(SQLTCHAR));
+            } else {
+                a.colSize = qMax(SQLULEN(1), SQLULEN(a.width));
+                a.sqlType = a.colSize > 8000 ? SQL_LONGVARCHAR : SQL_VARCHAR;
+                a.width = SQLLEN(a.colSize + 1);
+            }
+            break;
+        default:
+            return QSqlResult::execBatch(arrayBind);
+        }
+
+        a.data.fill(0, int(a.width * rows));
+        a.indicators.resize(rows);
+        for (int row = 0; row < rows; ++row) {
+            const QVariant &val = list.at(row);
+            char *p = a.data.data() + row * a.width;
+            if (val.isNull()) {
+                a.indicators[row] = SQL_NULL_DATA;
+                continue;
+            }
+            a.indicators[row] = 0;
+            switch (type) {
+            case QVariant::Int:
+                *reinterpret_cast<SQLINTEGER *>(p) = val.toInt();
+                break;
+            case QVariant::LongLong:
+                *reinterpret_cast<SQLBIGINT *>(p) = val.toLongLong();
+                break;
+            case QVariant::Double:
+                *reinterpret_cast<SQLDOUBLE *>(p) = val.toDouble();
+                break;
+            case QVariant::Bool:
+                *reinterpret_cast<SQLCHAR *>(p) = val.toBool() ? 1 : 0;
+                break;
+            default:
+                memcpy(p, encoded.at(row).constData(), encoded.at(row).size());
+                a.indicators[row] = encoded.at(row).size();
+                break;
+            }
+        }
+    }
+
+    setActive(false);
+    setAt(QSql::BeforeFirstRow);
+    d->rInf.clear();
+    d->fieldCache.clear();
+    d->fieldCacheIdx = 0;
+    if (isSelect())
+        SQLCloseCursor(d->hStmt);
+    d->finishStatement();
+    d->unbindColumns();
+    // the single row bindings are replaced by the arrays below
+    d->paramValues.clear();
+
+    SQLRETURN r = SQLSetStmtAttr(d->hStmt,
+                                 SQL_ATTR_PARAM_BIND_TYPE,
+                                 (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN,
+                                 SQL_IS_UINTEGER);
+    if (r == SQL_SUCCESS)
+        r = SQLSetStmtAttr(d->hStmt,
+                           SQL_ATTR_PARAMSET_SIZE,
+                           (SQLPOINTER)SQLULEN(rows),
+                           SQL_IS_UINTEGER);
+    for (int i = 0; r == SQL_SUCCESS && i < arrays.count(); ++i) {
+        ParamArray &a = arrays[i];
+        r = SQLBindParameter(d->hStmt,
+                             i + 1,
+                             SQL_PARAM_INPUT,
+                             a.cType,
+                             a.sqlType,
+                             a.colSize,
+                             0,
+                             (SQLPOINTER)a.data.data(),
+                             a.width,
+                             a.indicators.data());
+    }
+    if (r == SQL_SUCCESS) {
+        QElapsedTimer timer;
+        timer.start();
+        d->setExecuting(true);
+        r = SQLExecute(d->hStmt);
+        d->setExecuting(false);
+        d->addExecute(timer.nsecsElapsed(), r);
+        if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO && r != SQL_NO_DATA) {
+            qWarning() << "QODBCResult::execBatch: Unable to execute statement:" << qODBCWarn(d);
+            setLastError(qMakeError(QCoreApplication::translate("QODBCResult",
+                         "Unable to execute batch statement"), QSqlError::StatementError, d));
+        }
+    } else {
+        qWarning() << "QODBCResult::execBatch: unable to bind variable:" << qODBCWarn(d);
+        setLastError(qMakeError(QCoreApplication::translate("QODBCResult",
+                     "Unable to bind variable"), QSqlError::StatementError, d));
+        r = SQL_ERROR;
+    }
+
+    // back to single row parameters for the next exec()
+    SQLSetStmtAttr(d->hStmt, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, SQL_IS_UINTEGER);
+    SQLFreeStmt(d->hStmt, SQL_RESET_PARAMS);
+    if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO && r != SQL_NO_DATA)
+        return false;
+
+    SQLSMALLINT count = 0;
+    SQLNumResultCols(d->hStmt, &count);
+    if (count) {
+        setSelect(true);
+        for (int i = 0; i < count; ++i) {
+            d->rInf.append(qMakeFieldInfo(d, i));
+        }
+        d->fieldCache.resize(count);
+    } else {
+        setSelect(false);
+    }
+    setActive(true);
+    return true;
+}
+
 QSqlRecord QODBCResult::record() const
 {
     Q_D(const QODBCResult);
@@ -1802,6 +2731,7 @@ bool QODBCResult::nextResult()
     d->fieldCache.clear();
     d->fieldCacheIdx = 0;
     setSelect(false);
+    d->unbindColumns();
 
     SQLRETURN r = SQLMoreResults(d->hStmt);
     if (r != SQL_SUCCESS) {
@@ -1825,6 +2755,8 @@ bool QODBCResult::nextResult()
             d->rInf.append(qMakeFieldInfo(d, i));
         }
         d->fieldCache.resize(count);
+        if (isForwardOnly())
+            d->bindColumns(numericalPrecisionPolicy());
     } else {
         setSelect(false);
     }
@@ -1870,6 +2802,51 @@ QODBCDriver::~QODBCDriver()
     cleanup();
 }
 
+bool QODBCDriver::cancelQuery()
+{
+    Q_D(QODBCDriver);
+    QMutexLocker locker(&d->executingMutex);
+    if (!d->executingStmt)
+        return false;
+
+    // SQLCancel() may be called from another thread while SQLExecute() is blocking,
+    // the executing call then returns SQL_ERROR with SQLSTATE HY008.
+    SQLRETURN r = SQLCancel(d->executingStmt);
+    if (r != SQL_SUCCESS && r != SQL_SUCCESS_WITH_INFO) {
+        qSqlWarning(QLatin1String("QODBCDriver::cancelQuery: Unable to cancel statement"), d->executingStmt);
+        return false;
+    }
+    return true;
+}
+
+/*!
+    Returns counters for the statements run on this connection since it was
+    created or resetStatistics() was called. Times are in milliseconds.
+*/
+QVariantMap QODBCDriver::statistics() const
+{
+    Q_D(const QODBCDriver);
+    QVariantMap map;
+    map.insert(QLatin1String("prepares"), d->stats.prepares);
+    map.insert(QLatin1String("cached_prepares"), d->stats.cachedPrepares);
+    map.insert(QLatin1String("executes"), d->stats.executes);
+    map.insert(QLatin1String("fetches"), d->stats.fetches);
+    map.insert(QLatin1String("rows"), d->stats.rows);
+    map.insert(QLatin1String("bytes"), d->stats.bytes);
+    map.insert(QLatin1String("prepare_ms"), d->stats.prepareNsecs / 1000000);
+    map.insert(QLatin1String("execute_ms"), d->stats.executeNsecs / 1000000);
+    map.insert(QLatin1String("fetch_ms"), d->stats.fetchNsecs / 1000000);
+    map.insert(QLatin1String("diagnostics"), d->stats.diagnostics);
+    map.insert(QLatin1String("slow_statements"), d->stats.slowStatements);
+    return map;
+}
+
+void QODBCDriver::resetStatistics()
+{
+    Q_D(QODBCDriver);
+    d->stats = QODBCDriverPrivate::Statistics();
+}
+
 bool QODBCDriver::hasFeature(DriverFeature f) const
 {
     Q_D(const QODBCDriver);
@@ -1898,11 +2875,12 @@ bool QODBCDriver::hasFeature(DriverFeature f) const
         return true;
     case QuerySize:
     case NamedPlaceholders:
-    case BatchOperations:
     case SimpleLocking:
     case EventNotifications:
-    case CancelQuery:
         return false;
+    case CancelQuery:
+    case BatchOperations:
+        return true;
     case LastInsertId:
         return (d->dbmsType == MSSqlServer)
                 || (d->dbmsType == Sybase)
@@ -1943,6 +2921,8 @@ bool QODBCDriver::open(const QString & db,
                        SQL_ATTR_ODBC_VERSION,
                        (SQLPOINTER)qGetODBCVersion(connOpts),
                        SQL_IS_UINTEGER);
+    // Block cursors (SQL_ATTR_ROW_ARRAY_SIZE) are an ODBC 3 feature
+    d->hasBlockCursor = qGetODBCVersion(connOpts) == SQL_OV_ODBC3;
     r = SQLAllocHandle(SQL_HANDLE_DBC,
                         d->hEnv,
                         &d->hDbc);
@@ -2006,6 +2986,7 @@ bool QODBCDriver::open(const QString & db,
     d->checkDBMS();
     d->checkHasSQLFetchScroll();
     d->checkHasMultiResults();
+    d->checkGetDataExtensions();
     d->checkDateTimePrecision();
     setOpen(true);
     setOpenError(false);
@@ -2028,6 +3009,7 @@ void QODBCDriver::cleanup()
     Q_D(QODBCDriver);
     SQLRETURN r;
 
+    d->statementCache.clear();
     if(d->hDbc) {
         // Open statements/descriptors handles are automatically cleaned up by SQLDisconnect
         if (isOpen()) {
@@ -2235,6 +3217,17 @@ void QODBCDriverPrivate::checkHasMultiResults()
         hasMultiResultSets = fromSQLTCHAR(driverResponse, length/sizeof(SQLTCHAR)).startsWith(QLatin1Char('Y'));
 }
 
+void QODBCDriverPrivate::checkGetDataExtensions()
+{
+    SQLUINTEGER extensions = 0;
+    SQLRETURN r = SQLGetInfo(hDbc,
+                             SQL_GETDATA_EXTENSIONS,
+                             &extensions,
+                             sizeof(extensions),
+                             NULL);
+    getDataExtensions = (r == SQL_SUCCESS || r == SQL_SUCCESS_WITH_INFO) ? extensions : 0;
+}
+
 void QODBCDriverPrivate::checkDateTimePrecision()
 {
     SQLINTEGER columnSize;
@@ -52,6 +52,7 @@
 //
 
 #include <QtSql/qsqldriver.h>
+#include <QtCore/qvariant.h>
 
 #if defined (Q_OS_WIN32)
 #include <QtCore/qt_windows.h>
@@ -86,6 +87,7 @@ class Q_EXPORT_SQLDRIVER_ODBC QODBCDriver : public QSqlDriver
 {
     Q_DECLARE_PRIVATE(QODBCDriver)
     Q_OBJECT
+    Q_PROPERTY(QVariantMap statistics READ statistics)
     friend class QODBCResultPrivate;
 
 public:
@@ -112,6 +114,11 @@ public:
 
     bool isIdentifierEscaped(const QString &identifier, IdentifierType type) const override;
 
+    bool cancelQuery() override;
+
+    QVariantMap statistics() const;
+    Q_INVOKABLE void resetStatistics();
+
 protected:
     bool beginTransaction() override;
     bool commitTransaction() override;
@@ -0,0 +1,140 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "config.h"
+#include "version.h"
+
+#include <cstdio>
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QIODevice>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QString>
+#include <QStringList>
+#include <QSettings>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "logging.h"
+#include "utilities.h"
+#include "metatypes.h"
+#include "settingsdialog.h"
+#include "mocksqldriver.h"
+#include "sqlrestorebench.h"
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MACOS) && defined(HAVE_QSQLODBCX)
+#  include <QtPlugin>
+  Q_IMPORT_PLUGIN(QODBCXDriverPlugin)
+#endif
+
+int main(int argc, char* argv[]) {
+
+  QCoreApplication::setApplicationName("sqlrestore-bench");
+  QCoreApplication::setOrganizationName("sqlrestore-bench");
+  QCoreApplication::setApplicationVersion(SQLRESTORE_VERSION_DISPLAY);
+
+  logging::Init();
+  logging::SetOutputStderr(true);
+
+  QCoreApplication a(argc, argv);
+
+  SQLRestoreBench::Options options;
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Benchmarks the scan, unzip, restore, model and fetch paths of SQL Restore with synthetic backups and a mock SQL server. The ODBC fetch benchmark needs a real SQL server given with --odbc.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+
+  QCommandLineOption scan_files_option("scan-files", "Number of .bak files to scan.", "count", QString::number(options.scan_files));
+  QCommandLineOption scan_size_option("scan-size", "Size of each scanned .bak file in KB.", "kb", QString::number(options.scan_file_size / 1024));
+  QCommandLineOption zip_files_option("zip-files", "Number of ZIP archives to restore.", "count", QString::number(options.zip_files));
+  QCommandLineOption zip_size_option("zip-size", "Uncompressed size of each ZIP archive in MB.", "mb", QString::number(options.zip_file_size / (1024 * 1024)));
+  QCommandLineOption compressibility_option("compressibility", "Fraction of the backup data that compresses, from 0 to 1.", "fraction", QString::number(options.compressibility));
+  QCommandLineOption restore_latency_option("restore-latency", "Time the mock SQL server spends on each RESTORE DATABASE in ms.", "ms", QString::number(options.restore_latency_msec));
+  QCommandLineOption model_items_option("model-items", "Number of files in the model benchmark.", "count", QString::number(options.model_items));
+  QCommandLineOption fetch_rows_option("fetch-rows", "Number of rows in the fetch benchmark.", "count", QString::number(options.fetch_rows));
+  QCommandLineOption odbc_option("odbc", "ODBC connection string of a SQL server for the ODBC fetch benchmark, e.g. DSN=mssql;UID=sa;PWD=secret. Skipped when not given.", "connection string");
+  QCommandLineOption output_option(QStringList() << "o" << "output", "Write the JSON results to a file instead of stdout.", "file");
+  QCommandLineOption log_levels_option("log-levels", "Log levels, like *:3 for debug output.", "levels", "*:1");
+  parser.addOptions({ scan_files_option, scan_size_option, zip_files_option, zip_size_option, compressibility_option, restore_latency_option, model_items_option, fetch_rows_option, odbc_option, output_option, log_levels_option });
+  parser.process(a);
+
+  logging::SetLevels(parser.value(log_levels_option));
+
+  options.scan_files = parser.value(scan_files_option).toInt();
+  options.scan_file_size = parser.value(scan_size_option).toULongLong() * 1024;
+  options.zip_files = parser.value(zip_files_option).toInt();
+  options.zip_file_size = parser.value(zip_size_option).toULongLong() * 1024 * 1024;
+  options.compressibility = parser.value(compressibility_option).toDouble();
+  options.restore_latency_msec = parser.value(restore_latency_option).toInt();
+  options.model_items = parser.value(model_items_option).toInt();
+  options.fetch_rows = parser.value(fetch_rows_option).toInt();
+  options.odbc_connection_string = parser.value(odbc_option);
+
+  QTemporaryDir dir;
+  if (!dir.isValid()) {
+    fprintf(stderr, "Unable to create a temporary directory.\n");
+    return 1;
+  }
+  options.path = dir.path();
+
+  // Keep the settings away from the real ones, and point them at the mock SQL server and the synthetic backups.
+  QSettings::setDefaultFormat(QSettings::IniFormat);
+  QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, dir.path());
+  {
+    QSettings s;
+    s.beginGroup(SettingsDialog::kSettingsGroup);
+    s.setValue("driver", MockSqlDriver::kDriverName);
+    s.setValue("odbc_driver", "Mock");
+    s.setValue("server", "mock");
+    s.setValue("trusted_connection", true);
+    s.setValue("login_timeout", 5);
+    s.setValue("local_path", dir.path());
+    s.setValue("remote_path", dir.path());
+    s.endGroup();
+  }
+
+  Q_INIT_RESOURCE(data);
+  Utilities::Seed();
+  SQLRestore_Metatypes::RegisterMetaTypes();
+  MockSqlDriver::Register();
+
+  SQLRestoreBench bench;
+  const QJsonObject json = bench.Run(options);
+  const QByteArray data = QJsonDocument(json).toJson(QJsonDocument::Indented);
+
+  if (parser.isSet(output_option)) {
+    QFile file(parser.value(output_option));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+      fprintf(stderr, "Unable to write %s.\n", file.fileName().toLocal8Bit().constData());
+      return 1;
+    }
+    file.close();
+  }
+  else {
+    fprintf(stdout, "%s", data.constData());
+  }
+
+  return json.contains("error") ? 1 : 0;
+
+}
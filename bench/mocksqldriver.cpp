@@ -0,0 +1,372 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <atomic>
+
+#include <QtGlobal>
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlResult>
+#include <QSqlRecord>
+#include <QSqlField>
+#include <QSqlError>
+
+#include "mocksqldriver.h"
+
+const char *MockSqlDriver::kDriverName = "QMOCKSQL";
+
+QMutex MockSqlDriver::sMutex;
+MockSqlDriver::Config MockSqlDriver::sConfig;
+MockSqlDriver::Statistics MockSqlDriver::sStatistics;
+QMap<int, MockSqlDriver::RunningRestore> MockSqlDriver::sRestores;
+std::atomic_int MockSqlDriver::sNextSessionID(51);
+
+MockSqlDriver::Config::Config() :
+  connect_msec(0),
+  query_msec(0),
+  headeronly_msec(0),
+  verifyonly_msec(0),
+  filelistonly_msec(0),
+  restore_msec(0),
+  product_major_version(15),
+  software_version_major(15),
+  databases_per_backup(1),
+  databases_exist(true),
+  fetch_rows(0) {}
+
+MockSqlDriver::MockSqlDriver(QObject *parent) : QSqlDriver(parent), session_id_(0), cancel_requested_(false) {}
+
+MockSqlDriver::~MockSqlDriver() = default;
+
+void MockSqlDriver::Register() {
+
+  if (QSqlDatabase::isDriverAvailable(kDriverName)) return;
+  QSqlDatabase::registerSqlDriver(kDriverName, new QSqlDriverCreator<MockSqlDriver>);
+
+}
+
+MockSqlDriver::Config MockSqlDriver::config() {
+
+  QMutexLocker l(&sMutex);
+  return sConfig;
+
+}
+
+void MockSqlDriver::SetConfig(const Config &config) {
+
+  QMutexLocker l(&sMutex);
+  sConfig = config;
+
+}
+
+MockSqlDriver::Statistics MockSqlDriver::statistics() {
+
+  QMutexLocker l(&sMutex);
+  return sStatistics;
+
+}
+
+void MockSqlDriver::ResetStatistics() {
+
+  QMutexLocker l(&sMutex);
+  sStatistics = Statistics();
+
+}
+
+void MockSqlDriver::AddStatement(const bool success) {
+
+  QMutexLocker l(&sMutex);
+  ++sStatistics.statements;
+  if (!success) ++sStatistics.errors;
+
+}
+
+void MockSqlDriver::AddRestore(const bool cancelled) {
+
+  QMutexLocker l(&sMutex);
+  ++sStatistics.restores;
+  if (cancelled) ++sStatistics.cancels;
+
+}
+
+bool MockSqlDriver::hasFeature(DriverFeature feature) const {
+
+  switch (feature) {
+    case QuerySize:
+    case CancelQuery:
+      return true;
+    default:
+      return false;
+  }
+
+}
+
+bool MockSqlDriver::open(const QString &db, const QString &user, const QString &password, const QString &host, int port, const QString &connect_options) {
+
+  Q_UNUSED(db)
+  Q_UNUSED(user)
+  Q_UNUSED(password)
+  Q_UNUSED(host)
+  Q_UNUSED(port)
+  Q_UNUSED(connect_options)
+
+  const int connect_msec = config().connect_msec;
+  if (connect_msec > 0) QThread::msleep(static_cast<unsigned long>(connect_msec));
+
+  {
+    QMutexLocker l(&sMutex);
+    ++sStatistics.connections;
+  }
+
+  session_id_ = sNextSessionID++;
+  cancel_requested_ = false;
+  setOpen(true);
+  setOpenError(false);
+  return true;
+
+}
+
+void MockSqlDriver::close() {
+
+  if (isOpen()) {
+    FinishRestore(session_id_);
+    setOpen(false);
+    setOpenError(false);
+  }
+
+}
+
+QSqlResult *MockSqlDriver::createResult() const {
+  return new MockSqlResult(this);
+}
+
+bool MockSqlDriver::cancelQuery() {
+
+  cancel_requested_ = true;
+  return true;
+
+}
+
+void MockSqlDriver::StartRestore(const int session_id, const int duration_msec) {
+
+  QMutexLocker l(&sMutex);
+  RunningRestore restore;
+  restore.timer.start();
+  restore.duration_msec = duration_msec;
+  sRestores.insert(session_id, restore);
+
+}
+
+void MockSqlDriver::FinishRestore(const int session_id) {
+
+  QMutexLocker l(&sMutex);
+  sRestores.remove(session_id);
+
+}
+
+double MockSqlDriver::RestoreProgress(const int session_id) {
+
+  QMutexLocker l(&sMutex);
+  if (!sRestores.contains(session_id)) return -1.0;
+  const RunningRestore &restore = sRestores[session_id];
+  if (restore.duration_msec <= 0) return 100.0;
+  return qMin(100.0, static_cast<double>(restore.timer.elapsed()) * 100.0 / static_cast<double>(restore.duration_msec));
+
+}
+
+MockSqlResult::MockSqlResult(const MockSqlDriver *driver) : QSqlResult(driver), driver_(driver) {}
+
+void MockSqlResult::SetColumns(const QStringList &columns) {
+
+  for (const QString &column : columns) {
+    record_.append(QSqlField(column));
+  }
+
+}
+
+void MockSqlResult::AddRow(const QVariantList &row) {
+  rows_ << row;
+}
+
+bool MockSqlResult::Sleep(const int msec) {
+
+  // Sleep in small steps so cancelQuery() from another thread is noticed quickly.
+  QElapsedTimer timer;
+  timer.start();
+  while (timer.elapsed() < msec) {
+    if (driver_->cancel_requested()) return false;
+    QThread::msleep(static_cast<unsigned long>(qBound(static_cast<qint64>(1), static_cast<qint64>(msec) - timer.elapsed(), static_cast<qint64>(10))));
+  }
+  return !driver_->cancel_requested();
+
+}
+
+bool MockSqlResult::Fail(const QString &error) {
+
+  setLastError(QSqlError(QStringLiteral("Mock SQL server"), error, QSqlError::StatementError));
+  MockSqlDriver::AddStatement(false);
+  return false;
+
+}
+
+QString MockSqlResult::BackupName(const QString &query) {
+
+  // The database names are taken from the backup filename, like the real backups.
+  QRegularExpressionMatch match = QRegularExpression("DISK\\s*=\\s*'([^']*)'", QRegularExpression::CaseInsensitiveOption).match(query);
+  if (!match.hasMatch()) return QString("mockdb");
+  QString filename = match.captured(1);
+  filename.replace('\\', '/');
+  return QFileInfo(filename).completeBaseName();
+
+}
+
+bool MockSqlResult::reset(const QString &query) {
+
+  setActive(false);
+  setAt(QSql::BeforeFirstRow);
+  record_.clear();
+  rows_.clear();
+  driver_->clear_cancel_requested();
+
+  const MockSqlDriver::Config config = MockSqlDriver::config();
+  const QString statement = query.simplified().toUpper();
+
+  if (!Sleep(config.query_msec)) return Fail(QStringLiteral("Query cancelled."));
+
+  if (statement.contains("SERVERPROPERTY")) {
+    SetColumns(QStringList() << "ProductMajorVersion" << "SPID");
+    AddRow(QVariantList() << QString::number(config.product_major_version) << driver_->session_id());
+  }
+  else if (statement.startsWith("RESTORE HEADERONLY")) {
+    if (!Sleep(config.headeronly_msec)) return Fail(QStringLiteral("Query cancelled."));
+    SetColumns(QStringList() << "BackupType" << "Position" << "DatabaseName" << "SoftwareVersionMajor");
+    const QString name = BackupName(query);
+    for (int i = 1 ; i <= config.databases_per_backup ; ++i) {
+      AddRow(QVariantList() << 1 << i << (i == 1 ? name : QString("%1_%2").arg(name).arg(i)) << config.software_version_major);
+    }
+  }
+  else if (statement.startsWith("RESTORE VERIFYONLY")) {
+    if (!Sleep(config.verifyonly_msec)) return Fail(QStringLiteral("Query cancelled."));
+  }
+  else if (statement.startsWith("RESTORE FILELISTONLY")) {
+    if (!Sleep(config.filelistonly_msec)) return Fail(QStringLiteral("Query cancelled."));
+    const QString name = BackupName(query);
+    SetColumns(QStringList() << "LogicalName" << "Type");
+    AddRow(QVariantList() << name << "D");
+    AddRow(QVariantList() << name + "_log" << "L");
+  }
+  else if (statement.startsWith("RESTORE DATABASE")) {
+    MockSqlDriver::StartRestore(driver_->session_id(), config.restore_msec);
+    const bool success = Sleep(config.restore_msec);
+    MockSqlDriver::FinishRestore(driver_->session_id());
+    MockSqlDriver::AddRestore(!success);
+    if (!success) return Fail(QStringLiteral("Restore cancelled."));
+  }
+  else if (statement.contains("SYS.MASTER_FILES")) {
+    SetColumns(QStringList() << "DatabaseName" << "PhysicalName" << "TypeofFile");
+    AddRow(QVariantList() << "master" << "C:\\MockSQL\\DATA\\master.mdf" << "ROWS");
+    AddRow(QVariantList() << "master" << "C:\\MockSQL\\DATA\\mastlog.ldf" << "LOG");
+  }
+  else if (statement.contains("SYS.DATABASES")) {
+    SetColumns(QStringList() << "name" << "state_desc");
+    if (config.databases_exist) {
+      AddRow(QVariantList() << "mockdb" << "ONLINE");
+    }
+  }
+  else if (statement.contains("..SYSFILES")) {
+    SetColumns(QStringList() << "filename");
+    AddRow(QVariantList() << "C:\\MockSQL\\DATA\\mockdb.mdf");
+    AddRow(QVariantList() << "C:\\MockSQL\\DATA\\mockdb_log.ldf");
+  }
+  else if (statement.contains("SYS.DM_EXEC_REQUESTS")) {
+    SetColumns(QStringList() << "percent_complete");
+    QRegularExpressionMatch match = QRegularExpression("SESSION_ID\\s*=\\s*(\\d+)").match(statement);
+    const double progress = match.hasMatch() ? MockSqlDriver::RestoreProgress(match.captured(1).toInt()) : -1.0;
+    if (progress >= 0.0) {
+      AddRow(QVariantList() << progress);
+    }
+  }
+  else if (statement.startsWith("SELECT") && statement.contains("FROM MOCK_ROWS")) {
+    SetColumns(QStringList() << "id" << "name" << "size" << "modified");
+    const QDateTime modified(QDate(2020, 1, 1), QTime(0, 0));
+    for (int i = 0 ; i < config.fetch_rows ; ++i) {
+      AddRow(QVariantList() << i << QString("mockdb_%1").arg(i) << static_cast<qint64>(i) * 1024 << modified.addSecs(i));
+    }
+  }
+  else if (!statement.startsWith("ALTER DATABASE")) {
+    return Fail(QString("Unsupported statement: %1").arg(query));
+  }
+
+  MockSqlDriver::AddStatement(true);
+  setSelect(!record_.isEmpty());
+  setActive(true);
+  return true;
+
+}
+
+QVariant MockSqlResult::data(int i) {
+
+  if (at() < 0 || at() >= rows_.count() || i < 0 || i >= rows_[at()].count()) return QVariant();
+  return rows_[at()][i];
+
+}
+
+bool MockSqlResult::isNull(int i) {
+  return data(i).isNull();
+}
+
+bool MockSqlResult::fetch(int i) {
+
+  if (i < 0 || i >= rows_.count()) return false;
+  setAt(i);
+  return true;
+
+}
+
+bool MockSqlResult::fetchFirst() {
+  return fetch(0);
+}
+
+bool MockSqlResult::fetchLast() {
+  return fetch(rows_.count() - 1);
+}
+
+int MockSqlResult::size() {
+  return isSelect() ? rows_.count() : -1;
+}
+
+int MockSqlResult::numRowsAffected() {
+  return isSelect() ? -1 : 0;
+}
+
+QSqlRecord MockSqlResult::record() const {
+  return record_;
+}
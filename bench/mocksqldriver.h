@@ -0,0 +1,147 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef MOCKSQLDRIVER_H
+#define MOCKSQLDRIVER_H
+
+#include <atomic>
+
+#include <QtGlobal>
+#include <QMutex>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QSqlDriver>
+#include <QSqlResult>
+#include <QSqlRecord>
+
+// Stand-in for the SQL server used by the benchmarks, registered as the "QMOCKSQL" driver.
+// Answers the statements BackupBackend::RestoreBackup() runs with canned result sets after a configurable latency.
+// "SELECT ... FROM mock_rows" returns fetch_rows generated rows for measuring the fetch rate.
+
+class MockSqlDriver : public QSqlDriver {
+  Q_OBJECT
+
+ public:
+  explicit MockSqlDriver(QObject *parent = nullptr);
+  ~MockSqlDriver() override;
+
+  static const char *kDriverName;
+
+  struct Config {
+    Config();
+    int connect_msec;
+    int query_msec;
+    int headeronly_msec;
+    int verifyonly_msec;
+    int filelistonly_msec;
+    int restore_msec;
+    int product_major_version;
+    int software_version_major;
+    int databases_per_backup;
+    bool databases_exist;
+    int fetch_rows;
+  };
+
+  struct Statistics {
+    Statistics() : connections(0), statements(0), restores(0), cancels(0), errors(0) {}
+    quint64 connections;
+    quint64 statements;
+    quint64 restores;
+    quint64 cancels;
+    quint64 errors;
+  };
+
+  // Registers the driver with QSqlDatabase, can be called more than once.
+  static void Register();
+
+  static Config config();
+  static void SetConfig(const Config &config);
+  static Statistics statistics();
+  static void ResetStatistics();
+
+  bool hasFeature(DriverFeature feature) const override;
+  bool open(const QString &db, const QString &user, const QString &password, const QString &host, int port, const QString &connect_options) override;
+  void close() override;
+  QSqlResult *createResult() const override;
+  bool cancelQuery() override;
+
+  int session_id() const { return session_id_; }
+  bool cancel_requested() const { return cancel_requested_; }
+  void clear_cancel_requested() const { cancel_requested_ = false; }
+
+  // Restore progress for sys.dm_exec_requests, keyed by the session ID running the restore.
+  static void StartRestore(const int session_id, const int duration_msec);
+  static void FinishRestore(const int session_id);
+  static double RestoreProgress(const int session_id);
+
+  static void AddStatement(const bool success);
+  static void AddRestore(const bool cancelled);
+
+ private:
+  struct RunningRestore {
+    QElapsedTimer timer;
+    int duration_msec;
+  };
+
+  static QMutex sMutex;
+  static Config sConfig;
+  static Statistics sStatistics;
+  static QMap<int, RunningRestore> sRestores;
+  static std::atomic_int sNextSessionID;
+
+  int session_id_;
+  mutable std::atomic_bool cancel_requested_;
+
+};
+
+class MockSqlResult : public QSqlResult {
+
+ public:
+  explicit MockSqlResult(const MockSqlDriver *driver);
+
+ protected:
+  bool reset(const QString &query) override;
+  QVariant data(int i) override;
+  bool isNull(int i) override;
+  bool fetch(int i) override;
+  bool fetchFirst() override;
+  bool fetchLast() override;
+  int size() override;
+  int numRowsAffected() override;
+  QSqlRecord record() const override;
+
+ private:
+  void SetColumns(const QStringList &columns);
+  void AddRow(const QVariantList &row);
+  bool Sleep(const int msec);
+  bool Fail(const QString &error);
+  static QString BackupName(const QString &query);
+
+ private:
+  const MockSqlDriver *driver_;
+  QSqlRecord record_;
+  QList<QVariantList> rows_;
+
+};
+
+#endif  // MOCKSQLDRIVER_H
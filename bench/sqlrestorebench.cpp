@@ -0,0 +1,401 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QObject>
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QEventLoop>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QSettings>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "logging.h"
+#include "settingsdialog.h"
+#include "bakfileitem.h"
+#include "bakfilebackend.h"
+#include "bakfilemodel.h"
+#include "bakfilefilter.h"
+#include "backupbackend.h"
+#include "backupresult.h"
+#include "mocksqldriver.h"
+#include "syntheticbackup.h"
+#include "sqlrestorebench.h"
+
+SQLRestoreBench::Options::Options() :
+  scan_files(1000),
+  scan_file_size(64 * 1024),
+  zip_files(4),
+  zip_file_size(64 * 1024 * 1024),
+  compressibility(0.5),
+  restore_latency_msec(0),
+  model_items(100000),
+  fetch_rows(100000) {}
+
+SQLRestoreBench::SQLRestoreBench(QObject *parent) :
+  QObject(parent),
+  restores_(0),
+  restores_failed_(0),
+  bytes_unzipped_(0),
+  unzip_msec_(0),
+  crc_msec_(0),
+  restore_msec_(0),
+  total_msec_(0) {}
+
+double SQLRestoreBench::PerSecond(const double count, const qint64 nsecs) {
+
+  if (nsecs <= 0) return 0.0;
+  return count / (static_cast<double>(nsecs) / 1000000000.0);
+
+}
+
+QJsonObject SQLRestoreBench::Run(const Options &options) {
+
+  QJsonObject json;
+  json["qt"] = QString(qVersion());
+
+  QJsonObject dataset;
+  dataset["scan_files"] = options.scan_files;
+  dataset["scan_file_size"] = static_cast<qint64>(options.scan_file_size);
+  dataset["zip_files"] = options.zip_files;
+  dataset["zip_file_size"] = static_cast<qint64>(options.zip_file_size);
+  dataset["compressibility"] = options.compressibility;
+  dataset["restore_latency_ms"] = options.restore_latency_msec;
+  dataset["model_items"] = options.model_items;
+  dataset["fetch_rows"] = options.fetch_rows;
+  dataset["odbc"] = !options.odbc_connection_string.isEmpty();
+  json["dataset"] = dataset;
+
+  QElapsedTimer timer;
+  timer.start();
+  if (!Generate(options)) {
+    json["error"] = QString("Unable to write the synthetic backups to %1.").arg(options.path);
+    return json;
+  }
+  json["generate_ms"] = timer.elapsed();
+
+  json["scan"] = Scan(options);
+  json["restore"] = Restore(options);
+  json["model"] = Model(options);
+  json["mock_fetch"] = MockFetch(options);
+  json["odbc_fetch"] = OdbcFetch(options);
+
+  return json;
+
+}
+
+bool SQLRestoreBench::Generate(const Options &options) {
+
+  SyntheticBackup generator;
+  for (int i = 0 ; i < options.scan_files ; ++i) {
+    if (!generator.WriteBakFile(QString("%1/scan_%2.bak").arg(options.path).arg(i, 6, 10, QChar('0')), options.scan_file_size, options.compressibility)) return false;
+  }
+  for (int i = 0 ; i < options.zip_files ; ++i) {
+    const QString name = QString("restore_%1").arg(i, 6, 10, QChar('0'));
+    if (!generator.WriteZipFile(QString("%1/%2.zip").arg(options.path, name), name + ".bak", options.zip_file_size, options.compressibility)) return false;
+  }
+  return true;
+
+}
+
+QJsonObject SQLRestoreBench::Scan(const Options &options) {
+
+  // BakFileBackend scans the local path from the settings when they are reloaded.
+  BakFileBackend backend;
+  int found = 0;
+  bool finished = false;
+  QObject::connect(&backend, &BakFileBackend::AddedFiles, [&found](BakFileItemList files) { found += files.count(); });
+  QObject::connect(&backend, &BakFileBackend::ScanFinished, [&finished]() { finished = true; });
+
+  QElapsedTimer timer;
+  timer.start();
+  QMetaObject::invokeMethod(&backend, "ReloadSettings", Qt::DirectConnection);
+  while (!finished) {
+    QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+  }
+  const qint64 nsecs = timer.nsecsElapsed();
+  backend.Exit();
+
+  QJsonObject json;
+  json["files"] = options.scan_files + options.zip_files;
+  json["found"] = found;
+  json["ms"] = nsecs / 1000000;
+  json["files_per_sec"] = PerSecond(options.scan_files + options.zip_files, nsecs);
+  return json;
+
+}
+
+QJsonObject SQLRestoreBench::Restore(const Options &options) {
+
+  MockSqlDriver::Config config = MockSqlDriver::config();
+  config.restore_msec = options.restore_latency_msec;
+  MockSqlDriver::SetConfig(config);
+
+  BakFileItemList files;
+  for (int i = 0 ; i < options.zip_files ; ++i) {
+    const QString filename = QString("restore_%1.zip").arg(i, 6, 10, QChar('0'));
+    QFileInfo info(QString("%1/%2").arg(options.path, filename));
+    files << std::make_shared<BakFileItem>(filename, info.size(), info.lastModified(), true, QString("Zip archive data"));
+  }
+
+  BackupBackend backend;
+  backend.ReloadSettings();
+  connect(&backend, &BackupBackend::RestoreFinished, this, &SQLRestoreBench::RestoreFinished);
+
+  QEventLoop loop;
+  connect(&backend, &BackupBackend::RestoreComplete, &loop, &QEventLoop::quit);
+
+  QElapsedTimer timer;
+  timer.start();
+  QMetaObject::invokeMethod(&backend, "QueueRestores", Qt::QueuedConnection, Q_ARG(BakFileItemList, files));
+  if (!files.isEmpty()) loop.exec();
+  const qint64 nsecs = timer.nsecsElapsed();
+
+  QJsonObject json;
+  json["files"] = restores_;
+  json["failed"] = restores_failed_;
+  json["ms"] = nsecs / 1000000;
+  json["bytes_unzipped"] = static_cast<qint64>(bytes_unzipped_);
+  json["unzip_mbs"] = unzip_msec_ > 0 ? (static_cast<double>(bytes_unzipped_) / (1024.0 * 1024.0)) / (static_cast<double>(unzip_msec_) / 1000.0) : 0.0;
+  json["crc_mbs"] = crc_msec_ > 0 ? (static_cast<double>(bytes_unzipped_) / (1024.0 * 1024.0)) / (static_cast<double>(crc_msec_) / 1000.0) : 0.0;
+  json["restore_ms"] = restore_msec_;
+  json["overhead_ms"] = total_msec_ - unzip_msec_ - crc_msec_ - restore_msec_;
+  json["restores_per_sec"] = PerSecond(restores_, nsecs);
+  return json;
+
+}
+
+void SQLRestoreBench::RestoreFinished(const BackupResult &result) {
+
+  ++restores_;
+  if (!result.success()) {
+    ++restores_failed_;
+    qLog(Error) << result.filename() << result.errors();
+  }
+  bytes_unzipped_ += result.bytes_unzipped();
+  unzip_msec_ += result.phase_msec(BackupResult::Phase_Unzip);
+  crc_msec_ += result.phase_msec(BackupResult::Phase_CRC);
+  restore_msec_ += result.phase_msec(BackupResult::Phase_Restore);
+  total_msec_ += result.total_msec();
+
+}
+
+QJsonObject SQLRestoreBench::Model(const Options &options) {
+
+  // Same kind of names as the real backup folders, in random order.
+  QStringList names;
+  names.reserve(options.model_items);
+  for (int i = 0 ; i < options.model_items ; ++i) {
+    names << QString("Client%1_%2_FULL.%3").arg((static_cast<qint64>(i) * 7919) % options.model_items, 6, 10, QChar('0')).arg(i % 3 == 0 ? "Prod" : "Test").arg(i % 2 == 0 ? "zip" : "bak");
+  }
+
+  const QDateTime modified(QDate(2020, 1, 1), QTime(0, 0));
+  BakFileItemList items;
+  items.reserve(options.model_items);
+  for (int i = 0 ; i < options.model_items ; ++i) {
+    const bool compressed = names[i].endsWith("zip");
+    items << std::make_shared<BakFileItem>(names[i], static_cast<quint64>((static_cast<qint64>(i) * 104729) % 100000) * 1024 * 1024, modified.addSecs((static_cast<qint64>(i) * 65537) % 31536000), compressed, compressed ? QString("Zip archive data, at least v2.0 to extract") : QString("Windows NTbackup archive NT: Microsoft SQL Server"));
+  }
+
+  BakFileModel model(nullptr);
+
+  QJsonObject json;
+  json["items"] = options.model_items;
+
+  QElapsedTimer timer;
+  timer.start();
+  model.AddedFiles(items);
+  json["insert_ms"] = timer.nsecsElapsed() / 1000000.0;
+  json["exposed_rows"] = model.rowCount();
+
+  QJsonObject sort;
+  for (int column = 0 ; column < BakFileModel::ColumnCount ; ++column) {
+    timer.restart();
+    model.sort(column, Qt::AscendingOrder);
+    while (model.sort_pending()) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    sort[BakFileModel::column_name(static_cast<BakFileModel::Column>(column))] = timer.nsecsElapsed() / 1000000.0;
+  }
+  json["sort_ms"] = sort;
+
+  // Typing a filter one key at a time, each key refines the previous filter.
+  {
+    BakFileFilter filter;
+    filter.setSourceModel(&model);
+    filter.setFilterKeyColumns(QList<qint32>() << BakFileModel::Column_Filename << BakFileModel::Column_FileType);
+    const QString text("client0012");
+    QJsonObject filter_json;
+    qint64 total_nsecs = 0;
+    for (int i = 1 ; i <= text.size() ; ++i) {
+      timer.restart();
+      filter.SetFilterText(text.left(i));
+      while (filter.filter_pending()) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+      }
+      total_nsecs += timer.nsecsElapsed();
+    }
+    filter_json["keys"] = text.size();
+    filter_json["total_ms"] = total_nsecs / 1000000.0;
+    filter_json["rows"] = filter.rowCount();
+    // Several terms and a predicate, looked up in the search index instead of refining.
+    timer.restart();
+    filter.SetFilterText("client00 prod zip size:>0");
+    while (filter.filter_pending()) {
+      QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    filter_json["query_ms"] = timer.nsecsElapsed() / 1000000.0;
+    filter_json["query_rows"] = filter.rowCount();
+    filter_json["estimated_cost_ms"] = filter.EstimatedCostMs(filter.filter_text());
+    timer.restart();
+    filter.SetFilterText(QString());
+    filter_json["clear_ms"] = timer.nsecsElapsed() / 1000000.0;
+    json["filter"] = filter_json;
+  }
+
+  // Painting asks for the display value of every visible cell, scrolling through the whole model once.
+  {
+    timer.restart();
+    model.FetchAll();
+    json["fetch_all_ms"] = timer.nsecsElapsed() / 1000000.0;
+    qint64 calls = 0;
+    timer.restart();
+    for (int row = 0 ; row < model.rowCount() ; ++row) {
+      for (int column = 0 ; column < BakFileModel::ColumnCount ; ++column) {
+        if (model.index(row, column).data(Qt::DisplayRole).isValid()) ++calls;
+      }
+    }
+    const qint64 nsecs = timer.nsecsElapsed();
+    json["data_calls"] = calls;
+    json["data_calls_per_sec"] = nsecs > 0 ? calls * 1000000000.0 / nsecs : 0.0;
+  }
+
+  // Updates are typically a handful of files changing while the view is open.
+  BakFileItemList updated;
+  for (int i = 0 ; i < qMin(100, items.count()) ; ++i) {
+    updated << items[i];
+  }
+  timer.restart();
+  model.UpdatedFiles(updated);
+  json["update_100_ms"] = timer.nsecsElapsed() / 1000000.0;
+
+  timer.restart();
+  model.DeletedFiles(updated);
+  json["delete_100_ms"] = timer.nsecsElapsed() / 1000000.0;
+
+  return json;
+
+}
+
+QJsonObject SQLRestoreBench::MockFetch(const Options &options) {
+
+  MockSqlDriver::Config config = MockSqlDriver::config();
+  config.fetch_rows = options.fetch_rows;
+  MockSqlDriver::SetConfig(config);
+
+  // Only measures QSqlQuery iterating the mock driver's rows in memory, not the ODBC driver.
+  QJsonObject json;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase(MockSqlDriver::kDriverName, "sqlrestore_bench_fetch");
+    json = Fetch(db, "SELECT id, name, size, modified FROM mock_rows");
+  }
+  QSqlDatabase::removeDatabase("sqlrestore_bench_fetch");
+
+  json["driver"] = QString(MockSqlDriver::kDriverName);
+  return json;
+
+}
+
+QJsonObject SQLRestoreBench::OdbcFetch(const Options &options) {
+
+  QJsonObject json;
+  if (options.odbc_connection_string.isEmpty()) {
+    json["skipped"] = "No ODBC connection string given with --odbc.";
+    return json;
+  }
+
+#ifdef HAVE_QSQLODBCX
+  const QString driver("QODBCX");
+#else
+  const QString driver("QODBC");
+#endif
+  if (!QSqlDatabase::isDriverAvailable(driver)) {
+    json["skipped"] = QString("The %1 driver is not available.").arg(driver);
+    return json;
+  }
+
+  // Generates the rows on the server, so no table is needed.
+  const QString sql = QString("SELECT TOP (%1) ROW_NUMBER() OVER (ORDER BY (SELECT NULL)) AS id, a.name, CAST(a.object_id AS bigint) * 1024 AS size, a.modify_date AS modified FROM sys.all_objects a CROSS JOIN sys.all_objects b").arg(options.fetch_rows);
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase(driver, "sqlrestore_bench_odbc_fetch");
+    db.setDatabaseName(options.odbc_connection_string);
+    json = Fetch(db, sql);
+  }
+  QSqlDatabase::removeDatabase("sqlrestore_bench_odbc_fetch");
+
+  json["driver"] = driver;
+  return json;
+
+}
+
+QJsonObject SQLRestoreBench::Fetch(QSqlDatabase &db, const QString &sql) {
+
+  QJsonObject json;
+  if (!db.open()) {
+    json["error"] = db.lastError().text();
+    return json;
+  }
+
+  QSqlQuery query(db);
+  query.setForwardOnly(true);
+  QElapsedTimer timer;
+  timer.start();
+  if (!query.exec(sql)) {
+    json["error"] = query.lastError().text();
+    return json;
+  }
+  const qint64 exec_nsecs = timer.nsecsElapsed();
+  timer.restart();
+  qint64 checksum = 0;
+  int rows = 0;
+  while (query.next()) {
+    checksum += query.value(0).toLongLong() + query.value(1).toString().size() + query.value(2).toLongLong() + query.value(3).toDateTime().toSecsSinceEpoch();
+    ++rows;
+  }
+  const qint64 fetch_nsecs = timer.nsecsElapsed();
+
+  json["rows"] = rows;
+  json["checksum"] = checksum;
+  json["exec_ms"] = exec_nsecs / 1000000.0;
+  json["fetch_ms"] = fetch_nsecs / 1000000.0;
+  json["rows_per_sec"] = PerSecond(rows, fetch_nsecs);
+  return json;
+
+}
@@ -0,0 +1,81 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef SQLRESTOREBENCH_H
+#define SQLRESTOREBENCH_H
+
+#include <QtGlobal>
+#include <QObject>
+#include <QString>
+#include <QJsonObject>
+
+#include "backupresult.h"
+
+class QSqlDatabase;
+
+// Runs the benchmarks against a temporary directory with synthetic backups and returns the results as JSON.
+
+class SQLRestoreBench : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SQLRestoreBench(QObject *parent = nullptr);
+
+  struct Options {
+    Options();
+    QString path;
+    int scan_files;
+    quint64 scan_file_size;
+    int zip_files;
+    quint64 zip_file_size;
+    double compressibility;
+    int restore_latency_msec;
+    int model_items;
+    int fetch_rows;
+    QString odbc_connection_string;
+  };
+
+  QJsonObject Run(const Options &options);
+
+ private:
+  bool Generate(const Options &options);
+  QJsonObject Scan(const Options &options);
+  QJsonObject Restore(const Options &options);
+  QJsonObject Model(const Options &options);
+  QJsonObject MockFetch(const Options &options);
+  QJsonObject OdbcFetch(const Options &options);
+  static QJsonObject Fetch(QSqlDatabase &db, const QString &sql);
+
+  static double PerSecond(const double count, const qint64 nsecs);
+
+ private slots:
+  void RestoreFinished(const BackupResult &result);
+
+ private:
+  int restores_;
+  int restores_failed_;
+  quint64 bytes_unzipped_;
+  qint64 unzip_msec_;
+  qint64 crc_msec_;
+  qint64 restore_msec_;
+  qint64 total_msec_;
+
+};
+
+#endif  // SQLRESTOREBENCH_H
@@ -0,0 +1,136 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstring>
+
+#include <QtGlobal>
+#include <QIODevice>
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+
+#include <quazip.h>
+#include <quazipfile.h>
+#include <quazipnewinfo.h>
+
+#include "syntheticbackup.h"
+
+const int SyntheticBackup::kBlockSize = 65536;
+
+SyntheticBackup::SyntheticBackup(const quint32 seed) : state_(seed == 0 ? 1 : seed) {}
+
+quint32 SyntheticBackup::Next() {
+
+  // xorshift32, fast enough to not show up in the unzip numbers.
+  state_ ^= state_ << 13;
+  state_ ^= state_ >> 17;
+  state_ ^= state_ << 5;
+  return state_;
+
+}
+
+QByteArray SyntheticBackup::TapeHeader() {
+
+  static const char kSoftwareName[] = "Microsoft SQL Server";
+
+  QByteArray header(1024, '\0');
+  uchar *data = reinterpret_cast<uchar*>(header.data());
+  memcpy(data, "TAPE", 4);
+  data[10] = 14;  // OS ID, Windows NT
+  data[48] = 1;  // String type, ASCII
+  qToLittleEndian<quint16>(static_cast<quint16>(sizeof(kSoftwareName) - 1), data + 80);
+  qToLittleEndian<quint16>(0x100, data + 82);
+  qToLittleEndian<quint16>(512, data + 84);  // Format logical block size
+  memcpy(data + 0x100, kSoftwareName, sizeof(kSoftwareName) - 1);
+  return header;
+
+}
+
+QByteArray SyntheticBackup::Block(const double compressibility) {
+
+  QByteArray block(kBlockSize, '\0');
+  const int zeros = static_cast<int>(qBound(0.0, compressibility, 1.0) * static_cast<double>(kBlockSize)) & ~3;
+  char *data = block.data();
+  for (int i = zeros ; i < kBlockSize ; i += 4) {
+    const quint32 value = Next();
+    memcpy(data + i, &value, 4);
+  }
+  return block;
+
+}
+
+bool SyntheticBackup::WriteBakFile(const QString &filename, const quint64 size, const double compressibility) {
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+
+  const QByteArray header = TapeHeader();
+  if (file.write(header) != header.size()) return false;
+
+  quint64 written = static_cast<quint64>(header.size());
+  while (written < size) {
+    QByteArray block = Block(compressibility);
+    if (size - written < static_cast<quint64>(block.size())) block.truncate(static_cast<int>(size - written));
+    if (file.write(block) != block.size()) return false;
+    written += static_cast<quint64>(block.size());
+  }
+
+  file.close();
+  return true;
+
+}
+
+bool SyntheticBackup::WriteZipFile(const QString &filename, const QString &bak_filename, const quint64 size, const double compressibility) {
+
+  QuaZip archive(filename);
+  if (!archive.open(QuaZip::mdCreate)) return false;
+
+  {
+    QuaZipFile zfile(&archive);
+    if (!zfile.open(QIODevice::WriteOnly, QuaZipNewInfo(bak_filename))) {
+      archive.close();
+      return false;
+    }
+
+    const QByteArray header = TapeHeader();
+    zfile.write(header);
+
+    quint64 written = static_cast<quint64>(header.size());
+    while (written < size) {
+      QByteArray block = Block(compressibility);
+      if (size - written < static_cast<quint64>(block.size())) block.truncate(static_cast<int>(size - written));
+      if (zfile.write(block) != block.size()) {
+        zfile.close();
+        archive.close();
+        return false;
+      }
+      written += static_cast<quint64>(block.size());
+    }
+    zfile.close();
+    if (zfile.getZipError() != 0) {
+      archive.close();
+      return false;
+    }
+  }
+
+  archive.close();
+  return archive.getZipError() == 0;
+
+}
@@ -0,0 +1,52 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef SYNTHETICBACKUP_H
+#define SYNTHETICBACKUP_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+
+// Writes fake SQL server backups for the benchmarks.
+// The files start with a Microsoft Tape Format TAPE block which libmagic reports as a SQL server backup, the rest is filler.
+// Compressibility is the fraction of each block that is zeros, the remainder is pseudo random.
+
+class SyntheticBackup {
+
+ public:
+  explicit SyntheticBackup(const quint32 seed = 1);
+
+  static const int kBlockSize;
+
+  static QByteArray TapeHeader();
+
+  bool WriteBakFile(const QString &filename, const quint64 size, const double compressibility);
+  bool WriteZipFile(const QString &filename, const QString &bak_filename, const quint64 size, const double compressibility);
+
+ private:
+  QByteArray Block(const double compressibility);
+  quint32 Next();
+
+ private:
+  quint32 state_;
+
+};
+
+#endif  // SYNTHETICBACKUP_H
@@ -20,6 +20,7 @@
 #include <QtGlobal>
 
 #include <memory>
+#include <atomic>
 #include <boost/scope_exit.hpp>
 
 #include <quazip.h>
@@ -31,7 +32,7 @@
 #include <QCoreApplication>
 #include <QMutex>
 #include <QMap>
-#include <QQueue>
+#include <QDateTime>
 #include <QVariant>
 #include <QByteArray>
 #include <QString>
@@ -42,7 +43,12 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QStorageInfo>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrent>
+#include <QFuture>
 #include <QSqlDatabase>
+#include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSqlError>
@@ -55,6 +61,8 @@
 #include "scopedresult.h"
 #include "settingsdialog.h"
 #include "bakfileitem.h"
+#include "backupresult.h"
+#include "restorequeue.h"
 
 using Utilities::Seed;
 using Utilities::GetRandomStringWithCharsAndNumbers;
@@ -63,16 +71,22 @@ using Utilities::PrettySize;
 const int BackupBackend::kBufferChunkSize = 8192;
 const int BackupBackend::kZipTailSize = 8192;
 const char BackupBackend::kZipEndCentralSig[4] = { 0x50, 0x4B, 0x05, 0x06 };
+const int BackupBackend::kRestoreProgressIntervalMs = 2000;
+const int BackupBackend::kMaxTransferSizeStepKB = 64;
+const int BackupBackend::kMaxTransferSizeMaxKB = 4096;
 
 BackupBackend::BackupBackend(QObject *parent) :
   QObject(parent),
   db_connector_(new DBConnector(this)),
+  buffer_count_(0),
+  max_transfer_size_(0),
   in_progress_(false),
   jobs_total_(0),
   jobs_complete_(0),
   jobs_remaining_(0),
   jobs_current_(0),
-  cancel_requested_(false) {
+  cancel_requested_(false),
+  running_driver_(nullptr) {
 
   connect(this, &BackupBackend::StartRestoreBackup, this, &BackupBackend::RestoreBackup);
 
@@ -86,12 +100,20 @@ void BackupBackend::ReloadSettings() {
   s.beginGroup(SettingsDialog::kSettingsGroup);
   remote_path_ = s.value("remote_path", QDir::toNativeSeparators(QCoreApplication::applicationDirPath())).toString();
   local_path_ = s.value("local_path", QDir::toNativeSeparators(QCoreApplication::applicationDirPath())).toString();
+  buffer_count_ = s.value("buffer_count", 0).toInt();
+  max_transfer_size_ = s.value("max_transfer_size", 0).toInt();
   s.endGroup();
 
   db_connector_->ReloadSettings();
 
 }
 
+void BackupBackend::SetServer(const QString &server) {
+
+  db_connector_->SetServer(server);
+
+}
+
 QString BackupBackend::LocalFilePath(const QString &filename) {
 
   QString ret = local_path_;
@@ -139,11 +161,28 @@ QString BackupBackend::ProductMajorVersionToString(const int product_major_versi
 
 }
 
+QString BackupBackend::RestoreOptions() const {
+
+  // Zero leaves BUFFERCOUNT and MAXTRANSFERSIZE to the server.
+  // MAXTRANSFERSIZE must be a multiple of 64 KB and can not exceed 4 MB.
+
+  QString options;
+  if (buffer_count_ > 0) {
+    options.append(QString(", BUFFERCOUNT = %1").arg(buffer_count_));
+  }
+  if (max_transfer_size_ > 0) {
+    const int max_transfer_size = qBound(kMaxTransferSizeStepKB, max_transfer_size_ - (max_transfer_size_ % kMaxTransferSizeStepKB), kMaxTransferSizeMaxKB);
+    options.append(QString(", MAXTRANSFERSIZE = %1").arg(static_cast<qint64>(max_transfer_size) * 1024));
+  }
+  return options;
+
+}
+
 QSqlDatabase BackupBackend::Connect(ScopedResult *r) {
 
   // Connect to the SQL server
-  QMutexLocker l(db_connector_->Mutex());
-  DBConnectResult result = db_connector_->Connect();
+  ScopedPhaseTimer phase_timer(r, BackupResult::Phase_Connect);
+  DBConnectResult result = db_connector_->Lease();
   if (!result.db_.isOpen()) {
     r->failure(result.error_);
     return QSqlDatabase();
@@ -152,37 +191,84 @@ QSqlDatabase BackupBackend::Connect(ScopedResult *r) {
 
 }
 
-void BackupBackend::QueueRestores(BakFileItemList files) {
+bool BackupBackend::ExecQuery(QSqlDatabase &db, QSqlQuery &query, ScopedResult *r) {
+
+  // Keep track of the driver while the query is executing so CancelRestore() can abort it from another thread.
+  {
+    QMutexLocker l(&running_driver_mutex_);
+    running_driver_ = db.driver();
+  }
+  const bool success = query.exec();
+  {
+    QMutexLocker l(&running_driver_mutex_);
+    running_driver_ = nullptr;
+  }
+
+  if (!success) {
+    if (cancel_requested_) {
+      r->failure(tr("Restore cancelled."));
+    }
+    else {
+      r->failure(QStringList() << query.lastError().text() << query.lastQuery());
+    }
+  }
+
+  return success;
+
+}
+
+void BackupBackend::CancelRestore() {
+
+  cancel_requested_ = true;
+
+  QMutexLocker l(&running_driver_mutex_);
+  if (running_driver_ && running_driver_->hasFeature(QSqlDriver::CancelQuery)) {
+    qLog(Info) << "Cancelling running query.";
+    running_driver_->cancelQuery();
+  }
+
+}
 
-  jobs_total_ = 0;
-  jobs_complete_ = 0;
-  jobs_current_ = 0;
-  queue_.clear();
+void BackupBackend::QueueRestores(BakFileItemList files) {
 
   for (BakFileItemPtr bakfile : files) {
-    if (!bakfile->is_valid()) continue;
-    ++jobs_total_;
-    queue_.enqueue(bakfile);
+    EnqueueRestore(bakfile);
+  }
+
+  FlushQueue();
+
+}
+
+void BackupBackend::EnqueueRestore(BakFileItemPtr fileitem) {
+
+  if (!fileitem->is_valid()) return;
+
+  // Jobs queued while a restore is running are added to the running batch.
+  if (!in_progress_ && queue_.isEmpty()) {
+    jobs_total_ = 0;
+    jobs_complete_ = 0;
+    jobs_current_ = 0;
   }
 
+  ++jobs_total_;
+  queue_.Enqueue(fileitem);
+
   if (jobs_total_ > 1) {
     emit RestoreProgressAllMax(jobs_total_);
   }
 
-  FlushQueue();
-
 }
 
 void BackupBackend::FlushQueue() {
 
   if (!queue_.isEmpty() && jobs_remaining_ == 0) {
-    emit StartRestoreBackup(queue_.dequeue());
+    emit StartRestoreBackup(queue_.Dequeue());
   }
 
 }
 
 void BackupBackend::DeleteQueue() {
-  queue_.clear();
+  queue_.Clear();
 }
 
 void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
@@ -190,6 +276,7 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
   RestoreStarted();
 
   ScopedResult r(fileitem->filename());
+  r.set_server(db_connector_->server());
   connect(&r, &ScopedResult::Status, this, &BackupBackend::RestoreStatusCurrent);
   connect(&r, &ScopedResult::Success, this, &BackupBackend::RestoreSuccess);
   connect(&r, qOverload<QStringList>(&ScopedResult::Failure), this, &BackupBackend::RestoreFailure);
@@ -260,6 +347,10 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
   // Check Connection to the SQL server before uncompressing file.
   UpdateRestoreStatus(tr("Connecting to SQL server."));
   QSqlDatabase db = Connect(&r);
+  BOOST_SCOPE_EXIT(this_, &db, &r) {
+    r.FinishDriverStatistics();
+    this_->db_connector_->Return(db);
+  } BOOST_SCOPE_EXIT_END
   if (!db.isOpen()) {
     return;
   }
@@ -275,6 +366,8 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
     { // Look for the end of central directory signature
       // This will stop wasting time reading and CRC checking many of the incomplete/corrupt files.
 
+      ScopedPhaseTimer phase_timer(&r, BackupResult::Phase_EOCDCheck);
+
       QFile src_file(zipfile);
       if (src_file.size() > (kBufferChunkSize*2)) {
         BOOST_SCOPE_EXIT(&src_file) {
@@ -389,6 +482,10 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
 
       qint64 total_size_written = 0;
       QuaCrc32 checksum;
+      QElapsedTimer unzip_timer;
+      QElapsedTimer crc_timer;
+      qint64 crc_nsecs = 0;
+      unzip_timer.start();
       while (zfile.bytesAvailable() > 0) {
         if (RestoreCheckCancel(&r)) {
           zfile.close();
@@ -404,7 +501,9 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
           archive.close();
           return;
         }
+        crc_timer.start();
         checksum.update(buf);
+        crc_nsecs += crc_timer.nsecsElapsed();
         qint64 written = dst_file.write(buf.data(), buf.size());
         if (written != buf.size()) {
           r.failure(tr("Unable to write to temporary file \"%1\".: %2").arg(tmpfile_local, dst_file.errorString()));
@@ -418,6 +517,10 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
       }
       dst_file.flush();
       dst_file.close();
+      r.add_phase_nsecs(BackupResult::Phase_Unzip, unzip_timer.nsecsElapsed() - crc_nsecs);
+      r.add_phase_nsecs(BackupResult::Phase_CRC, crc_nsecs);
+      r.set_bytes_unzipped(total_size_written);
+      r.set_bytes_restored(total_size_written);
       if (total_size_written < zfile.size()) {
         zfile.close();
         archive.close();
@@ -443,33 +546,37 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
   else {
     bakfile = RemoteFilePath(fileitem->filename());
     tmpfile_local.clear();
+    r.set_bytes_restored(fileitem->file_size());
   }
 
   emit RestoreProgressCurrentValue(0);
 
   if (RestoreCheckCancel(&r)) return;
 
-  // Connect to the SQL server again
+  // Connect to the SQL server again, the pool hands back the same connection unless it was dropped during unzip.
   UpdateRestoreStatus(tr("Connecting to SQL server."));
+  r.FinishDriverStatistics();
+  db_connector_->Return(db);
   db = Connect(&r);
   if (!db.isOpen()) {
     return;
   }
+  r.TrackDriverStatistics(db.driver());
 
   if (RestoreCheckCancel(&r)) return;
 
-  // Get server version
+  // Get server version and the session ID used for polling the restore progress.
   int server_version = 0;
+  int session_id = 0;
   UpdateRestoreStatus(tr("Getting SQL server version"));
   {
     QSqlQuery query(db);
-    query.prepare("SELECT SERVERPROPERTY('ProductMajorVersion')");
-    if (!query.exec()) {
-      r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-      return;
-    }
+    query.setForwardOnly(true);
+    query.prepare("SELECT SERVERPROPERTY('ProductMajorVersion'), @@SPID");
+    if (!ExecQuery(db, query, &r)) return;
     while (query.next() && query.record().count() > 0) {
       server_version = QByteArray::fromHex(query.value(0).toByteArray()).toHex().toInt();
+      if (query.record().count() > 1) session_id = query.value(1).toInt();
     }
   }
 
@@ -481,12 +588,11 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
   int db_version_highest = 0;
   bool backup_incorrect = false;
   {
+    ScopedPhaseTimer phase_timer(&r, BackupResult::Phase_HeaderOnly);
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     query.prepare(QString("RESTORE HEADERONLY FROM DISK = '%1'").arg(bakfile));
-    if (!query.exec()) {
-      r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-      return;
-    }
+    if (!ExecQuery(db, query, &r)) return;
     while (query.next() && query.record().count() > 0) {
       int type = query.value("BackupType").toInt();
       if (type != 1) backup_incorrect = true;
@@ -525,13 +631,11 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
 
   UpdateRestoreStatus(tr("Verifying backup file \"%1\"").arg(bakfile));
   {
+    ScopedPhaseTimer phase_timer(&r, BackupResult::Phase_VerifyOnly);
     QSqlQuery query(db);
     query.prepare("RESTORE VERIFYONLY FROM DISK = :bakfile");
     query.bindValue(":bakfile", bakfile);
-    if (!query.exec()) {
-      r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-      return;
-    }
+    if (!ExecQuery(db, query, &r)) return;
   }
 
   if (RestoreCheckCancel(&r)) return;
@@ -544,15 +648,13 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
   UpdateRestoreStatus(tr("Getting DATA and LOG path for SQL server"));
   {
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     // FIXME: Use InstanceDefaultDataPath:
     //query.prepare("SELECT serverproperty('InstanceDefaultDataPath')");
     //query.prepare("SELECT physical_name from sys.master_files where name = :dbname");
     query.prepare("SELECT d.name DatabaseName, f.physical_name AS PhysicalName, f.type_desc TypeofFile FROM sys.master_files f INNER JOIN sys.databases d ON d.database_id = f.database_id WHERE d.name = :dbname");
     query.bindValue(":dbname", "master");
-    if (!query.exec()) {
-      r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-      return;
-    }
+    if (!ExecQuery(db, query, &r)) return;
     while (query.next() && query.record().count() > 0) {
       const QString type_of_file = query.value("TypeofFile").toString().toUpper();
       const QString physical_name = query.value("PhysicalName").toString();
@@ -603,14 +705,13 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
 
     UpdateRestoreStatus(tr("Getting logical names for database \"%1\"").arg(dbname));
     {
+      ScopedPhaseTimer phase_timer(&r, BackupResult::Phase_FileListOnly);
       QSqlQuery query(db);
+      query.setForwardOnly(true);
       query.prepare("RESTORE FILELISTONLY FROM DISK = :bakfile WITH FILE = :dbposition");
       query.bindValue(":bakfile", bakfile);
       query.bindValue(":dbposition", dbposition);
-      if (!query.exec()) {
-        r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-        return;
-      }
+      if (!ExecQuery(db, query, &r)) return;
       while (query.next()) {
         QString type = query.value("Type").toString().toUpper();
         if (type == "D") {
@@ -626,12 +727,10 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
     {
       UpdateRestoreStatus(tr("Checking if database \"%1\" exists.").arg(dbname));
       QSqlQuery query(db);
+      query.setForwardOnly(true);
       query.prepare("SELECT name, state_desc FROM sys.databases WHERE name = :dbname");
       query.bindValue(":dbname", dbname);
-      if (!query.exec()) {
-        r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-        return;
-      }
+      if (!ExecQuery(db, query, &r)) return;
       while (query.next()) {
         QString state = query.value("state_desc").toString();
         if (state != "RESTORING") exists = true;
@@ -642,20 +741,15 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
       UpdateRestoreStatus(tr("Setting database \"%1\" to single user.").arg(dbname));
       QSqlQuery query(db);
       query.prepare(QString("ALTER DATABASE %1 SET SINGLE_USER WITH ROLLBACK IMMEDIATE").arg(dbname));
-      if (!query.exec()) {
-        r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-        return;
-      }
+      if (!ExecQuery(db, query, &r)) return;
     }
 
     if (exists) {
       UpdateRestoreStatus(tr("Getting system filenames for database \"%1\".").arg(dbname));
       QSqlQuery query(db);
+      query.setForwardOnly(true);
       query.prepare(QString("SELECT filename FROM %1..sysfiles").arg(dbname));
-      if (!query.exec()) {
-        r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-        return;
-      }
+      if (!ExecQuery(db, query, &r)) return;
       while (query.next()) {
         QString s = query.value(0).toString();
         QString *p = nullptr;
@@ -687,8 +781,9 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
     const QString logfile = db_logpath + "\\" + dbname + "_log.ldf";
     {
       UpdateRestoreStatus(tr("Restoring database \"%1\".").arg(dbname));
+      ScopedPhaseTimer phase_timer(&r, BackupResult::Phase_Restore);
       QSqlQuery query(db);
-      query.prepare("RESTORE DATABASE :dbname FROM DISK = :bakfile WITH FILE = :dbposition, MOVE :old_logical_dbname TO :datafile, MOVE :old_logical_logname TO :logfile, NOUNLOAD, REPLACE");
+      query.prepare("RESTORE DATABASE :dbname FROM DISK = :bakfile WITH FILE = :dbposition, MOVE :old_logical_dbname TO :datafile, MOVE :old_logical_logname TO :logfile, NOUNLOAD, REPLACE" + RestoreOptions());
       query.bindValue(":dbname", dbname);
       query.bindValue(":bakfile", bakfile);
       query.bindValue(":dbposition", dbposition);
@@ -696,36 +791,47 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
       query.bindValue(":old_logical_logname", old_logical_logname);
       query.bindValue(":datafile", datafile);
       query.bindValue(":logfile", logfile);
-      if (!query.exec()) {
-        r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-        return;
+
+      // The restore blocks this thread, so poll the progress from a second connection.
+      std::atomic_bool restore_running(true);
+      QFuture<void> progress_poller;
+      if (session_id > 0) {
+        progress_poller = QtConcurrent::run([this, session_id, progress, &dbnames, &restore_running]() { PollRestoreProgress(session_id, progress, dbnames.count(), &restore_running); });
       }
+      const bool success = ExecQuery(db, query, &r);
+      restore_running = false;
+      progress_poller.waitForFinished();
+
+      if (!success) return;
     }
 
     // Rename logical names to reflect new client numbers.
-    if (dbname != old_logical_dbname) {
-      UpdateRestoreStatus(tr("Setting logical names for database \"%1\".").arg(dbname));
-      for (int y = 0 ; y < 3 ; ++y) {
-        QString new_logical_dbname;
-        if (y == 0) new_logical_dbname = dbname;
-        else new_logical_dbname = dbname + QString("_").repeated(y);
-        QSqlQuery query(db);
-        query.prepare(QString("ALTER DATABASE %1 MODIFY FILE (NAME = %2, NEWNAME = %3)").arg(dbname, old_logical_dbname, new_logical_dbname));
-        if (query.exec()) {
-          break;
+    {
+      ScopedPhaseTimer phase_timer(&r, BackupResult::Phase_Rename);
+      if (dbname != old_logical_dbname) {
+        UpdateRestoreStatus(tr("Setting logical names for database \"%1\".").arg(dbname));
+        for (int y = 0 ; y < 3 ; ++y) {
+          QString new_logical_dbname;
+          if (y == 0) new_logical_dbname = dbname;
+          else new_logical_dbname = dbname + QString("_").repeated(y);
+          QSqlQuery query(db);
+          query.prepare(QString("ALTER DATABASE %1 MODIFY FILE (NAME = %2, NEWNAME = %3)").arg(dbname, old_logical_dbname, new_logical_dbname));
+          if (query.exec()) {
+            break;
+          }
         }
       }
-    }
-    if (logname != old_logical_logname) {
-      UpdateRestoreStatus(tr("Setting logical names for database \"%1\".").arg(dbname));
-      for (int y = 0 ; y < 3 ; ++y) {
-        QString new_logical_logname;
-        if (y == 0) new_logical_logname = logname;
-        else new_logical_logname = logname + QString("_").repeated(y);
-        QSqlQuery query(db);
-        query.prepare(QString("ALTER DATABASE %1 MODIFY FILE (NAME = %2, NEWNAME = %3)").arg(dbname, old_logical_logname, new_logical_logname));
-        if (query.exec()) {
-          break;
+      if (logname != old_logical_logname) {
+        UpdateRestoreStatus(tr("Setting logical names for database \"%1\".").arg(dbname));
+        for (int y = 0 ; y < 3 ; ++y) {
+          QString new_logical_logname;
+          if (y == 0) new_logical_logname = logname;
+          else new_logical_logname = logname + QString("_").repeated(y);
+          QSqlQuery query(db);
+          query.prepare(QString("ALTER DATABASE %1 MODIFY FILE (NAME = %2, NEWNAME = %3)").arg(dbname, old_logical_logname, new_logical_logname));
+          if (query.exec()) {
+            break;
+          }
         }
       }
     }
@@ -734,10 +840,7 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
       UpdateRestoreStatus(tr("Setting database \"%1\" to multi user.").arg(dbname));
       QSqlQuery query(db);
       query.prepare("ALTER DATABASE " + dbname + " SET MULTI_USER");
-      if (!query.exec()) {
-        r.failure(QStringList() << query.lastError().text() << query.lastQuery());
-        return;
-      }
+      if (!ExecQuery(db, query, &r)) return;
     }
 
     emit RestoreProgressCurrentValue(static_cast<int>(static_cast<float>(progress) / static_cast<float>(dbnames.count()) * 100.0));
@@ -751,6 +854,48 @@ void BackupBackend::RestoreBackup(BakFileItemPtr fileitem) {
 
 }
 
+void BackupBackend::PollRestoreProgress(const int session_id, const int db_current, const int db_total, const std::atomic_bool *running) {
+
+  QSqlDatabase db;
+  {
+    DBConnectResult result = db_connector_->Lease();
+    if (!result.db_.isOpen()) {
+      qLog(Error) << "Unable to open connection for restore progress:" << result.error_;
+      return;
+    }
+    db = result.db_;
+  }
+
+  {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT percent_complete FROM sys.dm_exec_requests WHERE session_id = :session_id");
+    int last_value = -1;
+    while (*running) {
+      query.bindValue(":session_id", session_id);
+      if (!query.exec()) {
+        qLog(Error) << "Unable to get restore progress:" << query.lastError().text();
+        break;
+      }
+      if (query.next()) {
+        const double percent_complete = query.value(0).toDouble();
+        const int value = static_cast<int>((static_cast<double>(db_current - 1) + (percent_complete / 100.0)) / static_cast<double>(db_total) * 100.0);
+        if (value != last_value) {
+          last_value = value;
+          emit RestoreProgressCurrentValue(value);
+        }
+      }
+      query.finish();
+      for (int elapsed = 0 ; *running && elapsed < kRestoreProgressIntervalMs ; elapsed += 100) {
+        QThread::msleep(100);
+      }
+    }
+  }
+
+  db_connector_->Return(db);
+
+}
+
 void BackupBackend::RestoreStarted() {
 
   in_progress_ = true;
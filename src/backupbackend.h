@@ -20,14 +20,21 @@
 #ifndef BACKUPBACKEND_H
 #define BACKUPBACKEND_H
 
+#include <atomic>
+
 #include <QObject>
 #include <QString>
 #include <QStringList>
-#include <QQueue>
+#include <QMutex>
+#include <QDateTime>
 #include <QSqlDatabase>
 
 #include "bakfileitem.h"
+#include "backupresult.h"
+#include "restorequeue.h"
 
+class QSqlQuery;
+class QSqlDriver;
 class DBConnector;
 class ScopedResult;
 
@@ -38,13 +45,19 @@ class BackupBackend : public QObject {
   explicit BackupBackend(QObject *parent = nullptr);
   ~BackupBackend();
 
+ public slots:
   void ReloadSettings();
+  void SetServer(const QString &server);
 
  private:
   QSqlDatabase Connect(ScopedResult *r);
+  bool ExecQuery(QSqlDatabase &db, QSqlQuery &query, ScopedResult *r);
   QString LocalFilePath(const QString &filename);
   QString RemoteFilePath(const QString &filename);
   QString ProductMajorVersionToString(const int product_major_version);
+  QString RestoreOptions() const;
+  void PollRestoreProgress(const int session_id, const int db_current, const int db_total, const std::atomic_bool *running);
+  void EnqueueRestore(BakFileItemPtr fileitem);
   void FlushQueue();
   void DeleteQueue();
   void UpdateRestoreStatus(const QString &message);
@@ -63,7 +76,7 @@ class BackupBackend : public QObject {
   void RestoreProgressCurrentValue(int);
   void RestoreSuccess();
   void RestoreFailure(QStringList errors);
-  void RestoreFinished(QString filename, bool success, QStringList errors);
+  void RestoreFinished(BackupResult result);
   void RestoreComplete();
 
  private slots:
@@ -73,22 +86,29 @@ class BackupBackend : public QObject {
 
  public slots:
   void QueueRestores(BakFileItemList bakfilelist);
-  void CancelRestore() { cancel_requested_ = true; }
+  void CancelRestore();
 
  private:
   static const int kBufferChunkSize;
   static const int kZipTailSize;
   static const char kZipEndCentralSig[4];
+  static const int kRestoreProgressIntervalMs;
+  static const int kMaxTransferSizeStepKB;
+  static const int kMaxTransferSizeMaxKB;
   DBConnector *db_connector_;
   QString local_path_;
   QString remote_path_;
+  int buffer_count_;
+  int max_transfer_size_;
   bool in_progress_;
-  QQueue<BakFileItemPtr> queue_;
+  RestoreQueue queue_;
   int jobs_total_;
   int jobs_complete_;
   int jobs_remaining_;
   int jobs_current_;
-  bool cancel_requested_;
+  std::atomic_bool cancel_requested_;
+  QMutex running_driver_mutex_;
+  QSqlDriver *running_driver_;
 
 };
 
@@ -0,0 +1,111 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <QtGlobal>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "backupresult.h"
+#include "utilities.h"
+
+BackupResult::BackupResult() : success_(false), total_msec_(0), phase_nsecs_{}, bytes_unzipped_(0), bytes_restored_(0) {}
+
+BackupResult::BackupResult(const QString &filename, const bool success, const QStringList &errors) : filename_(filename), success_(success), errors_(errors), total_msec_(0), phase_nsecs_{}, bytes_unzipped_(0), bytes_restored_(0) {}
+
+double BackupResult::MBPerSecond(const quint64 bytes, const qint64 nsecs) {
+
+  if (bytes == 0 || nsecs <= 0) return 0.0;
+  return (static_cast<double>(bytes) / (1024.0 * 1024.0)) / (static_cast<double>(nsecs) / 1000000000.0);
+
+}
+
+double BackupResult::unzip_mbs() const {
+  return MBPerSecond(bytes_unzipped_, phase_nsecs_[Phase_Unzip]);
+}
+
+double BackupResult::crc_mbs() const {
+  return MBPerSecond(bytes_unzipped_, phase_nsecs_[Phase_CRC]);
+}
+
+double BackupResult::restore_mbs() const {
+  return MBPerSecond(bytes_restored_, phase_nsecs_[Phase_Restore]);
+}
+
+QString BackupResult::PhaseName(const Phase phase) {
+
+  switch (phase) {
+    case Phase_Connect: return "connect";
+    case Phase_EOCDCheck: return "eocd_check";
+    case Phase_Unzip: return "unzip";
+    case Phase_CRC: return "crc";
+    case Phase_HeaderOnly: return "headeronly";
+    case Phase_VerifyOnly: return "verifyonly";
+    case Phase_FileListOnly: return "filelistonly";
+    case Phase_Restore: return "restore";
+    case Phase_Rename: return "rename";
+    case PhaseCount: break;
+  }
+  return QString();
+
+}
+
+QJsonObject BackupResult::ToJson() const {
+
+  QJsonObject phases;
+  for (int i = 0 ; i < PhaseCount ; ++i) {
+    phases[PhaseName(static_cast<Phase>(i))] = phase_msec(static_cast<Phase>(i));
+  }
+
+  QJsonObject json;
+  json["file"] = filename_;
+  if (!server_.isEmpty()) {
+    json["server"] = server_;
+  }
+  json["success"] = success_;
+  json["errors"] = QJsonArray::fromStringList(errors_);
+  json["total_ms"] = total_msec_;
+  json["phases_ms"] = phases;
+  json["bytes_unzipped"] = static_cast<qint64>(bytes_unzipped_);
+  json["bytes_restored"] = static_cast<qint64>(bytes_restored_);
+  json["unzip_mbs"] = unzip_mbs();
+  json["crc_mbs"] = crc_mbs();
+  json["restore_mbs"] = restore_mbs();
+  if (!driver_stats_.isEmpty()) {
+    json["driver"] = QJsonObject::fromVariantMap(driver_stats_);
+  }
+  return json;
+
+}
+
+QString BackupResult::Summary() const {
+
+  QStringList summary;
+  summary << QObject::tr("took %1").arg(Utilities::PrettyTime(static_cast<int>(total_msec_ / 1000)));
+  if (bytes_unzipped_ > 0) {
+    summary << QObject::tr("unzip %1 MB/s").arg(unzip_mbs(), 0, 'f', 1);
+  }
+  if (bytes_restored_ > 0) {
+    summary << QObject::tr("restore %1 MB/s").arg(restore_mbs(), 0, 'f', 1);
+  }
+  return summary.join(", ");
+
+}
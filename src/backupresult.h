@@ -20,21 +20,75 @@
 #ifndef BACKUPRESULT_H
 #define BACKUPRESULT_H
 
+#include <QtGlobal>
+#include <QMetaType>
 #include <QString>
 #include <QStringList>
+#include <QVariantMap>
+#include <QJsonObject>
 
 class BackupResult {
  public:
-  BackupResult(const QString &filename, const bool success, const QStringList &errors) : filename_(filename), success_(success), errors_(errors) {}
+  enum Phase {
+    Phase_Connect,
+    Phase_EOCDCheck,
+    Phase_Unzip,
+    Phase_CRC,
+    Phase_HeaderOnly,
+    Phase_VerifyOnly,
+    Phase_FileListOnly,
+    Phase_Restore,
+    Phase_Rename,
+    PhaseCount
+  };
 
-  QString filename() { return filename_; }
-  bool success() { return success_; }
-  QStringList errors() { return errors_; }
+  BackupResult();
+  BackupResult(const QString &filename, const bool success, const QStringList &errors);
+
+  QString filename() const { return filename_; }
+  QString server() const { return server_; }
+  bool success() const { return success_; }
+  QStringList errors() const { return errors_; }
+
+  qint64 total_msec() const { return total_msec_; }
+  qint64 phase_msec(const Phase phase) const { return phase_nsecs_[phase] / 1000000; }
+  quint64 bytes_unzipped() const { return bytes_unzipped_; }
+  quint64 bytes_restored() const { return bytes_restored_; }
+  double unzip_mbs() const;
+  double crc_mbs() const;
+  double restore_mbs() const;
+  QVariantMap driver_stats() const { return driver_stats_; }
+
+  void set_filename(const QString &filename) { filename_ = filename; }
+  void set_server(const QString &server) { server_ = server; }
+  void set_success(const bool success) { success_ = success; }
+  void add_error(const QString &error) { errors_ << error; }
+  void set_total_msec(const qint64 msec) { total_msec_ = msec; }
+  void add_phase_nsecs(const Phase phase, const qint64 nsecs) { phase_nsecs_[phase] += nsecs; }
+  void set_bytes_unzipped(const quint64 bytes) { bytes_unzipped_ = bytes; }
+  void set_bytes_restored(const quint64 bytes) { bytes_restored_ = bytes; }
+  void set_driver_stats(const QVariantMap &stats) { driver_stats_ = stats; }
+
+  static QString PhaseName(const Phase phase);
+
+  QJsonObject ToJson() const;
+  QString Summary() const;
+
+ private:
+  static double MBPerSecond(const quint64 bytes, const qint64 nsecs);
 
  private:
   QString filename_;
+  QString server_;
   bool success_;
   QStringList errors_;
+  qint64 total_msec_;
+  qint64 phase_nsecs_[PhaseCount];
+  quint64 bytes_unzipped_;
+  quint64 bytes_restored_;
+  QVariantMap driver_stats_;
 };
 
+Q_DECLARE_METATYPE(BackupResult)
+
 #endif  //  BACKUPRESULT_H
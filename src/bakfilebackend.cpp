@@ -377,6 +377,8 @@ void BakFileBackend::Scan() {
     emit LoadError(error);
   }
 
+  emit ScanFinished();
+
   cancel_requested_ = false;
 
   if (retrigger_scan) {
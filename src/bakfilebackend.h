@@ -61,6 +61,7 @@ class BakFileBackend : public QObject {
   void AddedFiles(BakFileItemList);
   void UpdatedFiles(BakFileItemList);
   void DeletedFiles(BakFileItemList);
+  void ScanFinished();
 
  private:
   QFileSystemWatcher *watcher_;
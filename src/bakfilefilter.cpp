@@ -17,47 +17,332 @@
 
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include <QSortFilterProxyModel>
 #include <QAbstractItemModel>
 #include <QList>
+#include <QVector>
+#include <QBitArray>
 #include <QVariant>
 #include <QString>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 #include "bakfilefilter.h"
+#include "bakfilemodel.h"
+
+// A filter pass expected to take longer than a frame is done in a background thread so typing doesn't block.
+const int BakFileFilter::kFrameMs = 16;
+
+// Matching rows to add to the view each time it scrolls to the end while filtering.
+const int BakFileFilter::kFetchMinMatches = 100;
+
+// Cost of matching a row until a filter pass has been measured.
+const qint64 BakFileFilter::kDefaultRowCostNs = 1000;
+
+BakFileFilter::BakFileFilter(QObject *parent) :
+    QSortFilterProxyModel(parent),
+    model_(nullptr),
+    use_candidates_(false),
+    candidates_revision_(0),
+    generation_(0),
+    base_generation_(1),
+    latest_generation_(std::make_shared<std::atomic<quint64>>(0)),
+    filter_watcher_(nullptr),
+    pending_rows_(0),
+    pending_generation_(0),
+    results_generation_(0),
+    full_row_cost_ns_(kDefaultRowCostNs),
+    refined_row_cost_ns_(kDefaultRowCostNs) {
 
-BakFileFilter::BakFileFilter(QObject *parent) : QSortFilterProxyModel(parent) {
   setDynamicSortFilter(true);
 }
 
+void BakFileFilter::setSourceModel(QAbstractItemModel *source_model) {
+
+  model_ = qobject_cast<BakFileModel*>(source_model);
+  QSortFilterProxyModel::setSourceModel(source_model);
+
+}
+
+void BakFileFilter::fetchMore(const QModelIndex &parent) {
+
+  // Only some of the rows in a page match the query, so pages are fetched until there's a screen of matches.
+  const int row_count = rowCount(parent);
+  do {
+    QSortFilterProxyModel::fetchMore(parent);
+  } while (!query_.is_empty() && rowCount(parent) - row_count < kFetchMinMatches && QSortFilterProxyModel::canFetchMore(parent));
+
+}
+
 void BakFileFilter::sort(int column, Qt::SortOrder order) {
   sourceModel()->sort(column, order);  // QAbstractItemModel
 }
- 
+
 void BakFileFilter::setFilterKeyColumns(const QList<qint32> &filter_columns) {
 
   filter_columns_.clear();
- 
+
   for (const qint32 column : filter_columns) {
     filter_columns_ << column;
   }
 
+  // The rejected rows were matched against other columns.
+  generation_ = NextGeneration();
+  base_generation_ = generation_;
+  UpdateCandidates();
+  if (!query_.is_empty()) invalidateFilter();
+
+  // A background match of the pending query used the old columns.
+  if (filter_watcher_) FilterInBackground(pending_query_, NextGeneration());
+
 }
- 
-bool BakFileFilter::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const {
 
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-  QString filter = filterRegularExpression().pattern();
-#else
-  QString filter = filterRegExp().pattern().toLower();
-#endif
-  if (filter_columns_.isEmpty() || filter.isEmpty()) return true;
+void BakFileFilter::SetFilterText(const QString &text) {
+
+  if (text == filter_text_) return;
+
+  const BakFileQuery query(text);
+  filter_text_ = text;
+  const quint64 generation = NextGeneration();
+  const bool refine = query.Refines(query_);
+
+  // Clearing the filter accepts every row without matching, so it's always done here.
+  // The applied query is kept until the background match of the new one is done.
+  if (model_ && !query.is_empty() && EstimatedCostMs(query) > kFrameMs) {
+    FilterInBackground(query, generation);
+    return;
+  }
+
+  filter_watcher_ = nullptr;
+  pending_items_.clear();
+  ApplyQuery(query, generation);
+  QElapsedTimer timer;
+  timer.start();
+  invalidateFilter();
+  if (!query_.is_empty() && model_) UpdateRowCost(refine, timer.nsecsElapsed(), model_->rowCount());
+
+}
+
+quint64 BakFileFilter::NextGeneration() {
+
+  // Also lets a background match of an older query give up.
+  return ++*latest_generation_;
+
+}
+
+void BakFileFilter::ApplyQuery(const BakFileQuery &query, const quint64 generation) {
+
+  // Rows that didn't match the old terms can't match terms that contain them.
+  if (!query.Refines(query_)) base_generation_ = generation;
+  generation_ = generation;
+  query_ = query;
+  UpdateCandidates();
+
+}
+
+qint64 BakFileFilter::EstimatedCostMs(const QString &text) const {
+
+  return EstimatedCostMs(BakFileQuery(text));
+
+}
+
+qint64 BakFileFilter::EstimatedCostMs(const BakFileQuery &query) const {
+
+  if (!model_) return 0;
+
+  const qint64 row_cost_ns = query.Refines(query_) ? refined_row_cost_ns_ : full_row_cost_ns_;
+  // A filter pass only matches the rows the model has exposed.
+  return row_cost_ns * model_->rowCount() / 1000000;
+
+}
+
+void BakFileFilter::UpdateRowCost(const bool refined, const qint64 nsecs, const int rows) {
+
+  if (rows == 0) return;
+
+  // Measurements are averaged with the previous ones of the same kind to smooth out noise.
+  qint64 &row_cost_ns = refined ? refined_row_cost_ns_ : full_row_cost_ns_;
+  row_cost_ns = qMax(Q_INT64_C(1), (row_cost_ns + nsecs / rows) / 2);
+
+}
+
+void BakFileFilter::FilterInBackground(const BakFileQuery &query, const quint64 generation) {
+
+  // The view keeps showing the previous results until the new ones are ready.
+  pending_items_ = model_->model_items();
+  pending_rows_ = model_->rowCount();
+  pending_query_ = query;
+  pending_generation_ = generation;
+  pending_timer_.start();
+  filter_watcher_ = new QFutureWatcher<MatchResults>(this);
+  connect(filter_watcher_, &QFutureWatcherBase::finished, this, &BakFileFilter::FilterFinished);
+  filter_watcher_->setFuture(QtConcurrent::run(&BakFileFilter::MatchItems, pending_items_, pending_rows_, pending_query_, filter_columns_, pending_generation_, latest_generation_));
+
+}
+
+BakFileFilter::MatchResults BakFileFilter::MatchItems(const BakFileModel::ModelItemList &items, const int count, const BakFileQuery &query, const QList<qint32> &columns, const quint64 generation, const std::shared_ptr<std::atomic<quint64>> &latest_generation) {
+
+  MatchResults results;
+  results.reserve(count);
+  for (int i = 0 ; i < count ; ++i) {
+    if ((i % 1024) == 0 && *latest_generation != generation) return MatchResults();
+    const BakFileModel::ModelItem &item = items[i];
+    results.insert(item.item.get(), (static_cast<quint64>(item.version) << 1) | (Matches(query, columns, item) ? 1 : 0));
+  }
+
+  return results;
+
+}
+
+void BakFileFilter::FilterFinished() {
+
+  QFutureWatcher<MatchResults> *watcher = static_cast<QFutureWatcher<MatchResults>*>(sender());
+  watcher->deleteLater();
+  if (watcher != filter_watcher_) return;
+  filter_watcher_ = nullptr;
+  if (pending_generation_ != *latest_generation_) return;
+
+  // The background match doesn't skip the rows rejected by the previous query, so it's a full pass.
+  UpdateRowCost(false, pending_timer_.nsecsElapsed(), pending_rows_);
+  results_ = watcher->result();
+  results_generation_ = pending_generation_;
+
+  // The results are in place before the query is applied, so exposing the rows doesn't match them again.
+  ApplyQuery(pending_query_, pending_generation_);
+  invalidateFilter();
+
+  // The rejected rows are marked now, rows changed later are matched normally.
+  // The copy of the rows is only released here so the items can't be freed and their addresses reused while the results are looked up.
+  results_.clear();
+  results_generation_ = 0;
+  pending_items_.clear();
+
+}
+
+void BakFileFilter::UpdateCandidates() {
+
+  candidates_.clear();
+  use_candidates_ = false;
+  if (!model_ || filter_columns_.isEmpty() || query_.terms().isEmpty()) return;
 
-  bool ret = false;
+  // The index only covers the filename and file type.
   for (const qint32 column : filter_columns_) {
-    QModelIndex idx = sourceModel()->index(source_row, column, source_parent);
-    ret = (idx.data().toString().toLower().contains(filter));
-    if (ret) return ret;
+    if (column != BakFileModel::Column_Filename && column != BakFileModel::Column_FileType) return;
   }
-  return ret;
+
+  use_candidates_ = model_->search_index().Candidates(query_.terms(), &candidates_);
+  candidates_revision_ = model_->search_index().revision();
+
+}
+
+bool BakFileFilter::Contains(const QString &haystack, const QString &needle) {
+
+  const int needle_size = needle.size();
+  if (needle_size == 0) return true;
+  if (haystack.size() < needle_size) return false;
+
+  // Look for the first character with std::find, which compilers vectorize, and only compare the rest of the needle on a hit.
+  const char16_t *needle_data = reinterpret_cast<const char16_t*>(needle.constData());
+  const char16_t first = needle_data[0];
+  const char16_t *p = reinterpret_cast<const char16_t*>(haystack.constData());
+  const char16_t *end = p + (haystack.size() - needle_size + 1);
+  const size_t rest = static_cast<size_t>(needle_size - 1) * sizeof(char16_t);
+  while ((p = std::find(p, end, first)) != end) {
+    if (memcmp(p + 1, needle_data + 1, rest) == 0) return true;
+    ++p;
+  }
+
+  return false;
+
+}
+
+bool BakFileFilter::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const {
+
+  if (query_.is_empty()) return true;
+
+  if (model_) {
+    if (model_->rejected_generation(source_row) >= base_generation_) return false;
+    if (results_generation_ == generation_) {
+      // Files added or updated after the rows were copied are matched normally.
+      const BakFileModel::ModelItem &item = model_->model_item(source_row);
+      MatchResults::const_iterator it = results_.constFind(item.item.get());
+      if (it != results_.constEnd() && (it.value() >> 1) == item.version) {
+        if (it.value() & 1) return true;
+        model_->set_rejected_generation(source_row, generation_);
+        return false;
+      }
+    }
+    if (use_candidates_ && model_->search_index().revision() == candidates_revision_) {
+      // Files added after the candidates were looked up have IDs past the end and are matched normally.
+      const int id = model_->search_index().id(model_->item_at(source_row).get());
+      if (id >= 0 && id < candidates_.size() && !candidates_.testBit(id)) {
+        model_->set_rejected_generation(source_row, generation_);
+        return false;
+      }
+    }
+  }
+
+  if (!MatchesRow(source_row, source_parent)) {
+    if (model_) model_->set_rejected_generation(source_row, generation_);
+    return false;
+  }
+
+  return true;
+
+}
+
+bool BakFileFilter::MatchesRow(const int source_row, const QModelIndex &source_parent) const {
+
+  if (model_) return Matches(query_, filter_columns_, model_->model_item(source_row));
+
+  if (query_.has_predicates()) return false;
+  if (query_.terms().isEmpty() || filter_columns_.isEmpty()) return true;
+
+  QVector<QString> texts(filter_columns_.count());
+  for (int i = 0 ; i < filter_columns_.count() ; ++i) {
+    texts[i] = sourceModel()->index(source_row, filter_columns_[i], source_parent).data().toString().toCaseFolded();
+  }
+
+  for (const QString &term : query_.terms()) {
+    bool found = false;
+    for (const QString &text : texts) {
+      if (Contains(text, term)) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) return false;
+  }
+
+  return true;
+
+}
+
+bool BakFileFilter::Matches(const BakFileQuery &query, const QList<qint32> &columns, const BakFileModel::ModelItem &item) {
+
+  // Only the copied values of the model item are used, this also runs in a background thread.
+  if (query.has_predicates() && !query.MatchesPredicates(item.file_size, item.modified / 1000)) return false;
+
+  if (query.terms().isEmpty() || columns.isEmpty()) return true;
+
+  for (const QString &term : query.terms()) {
+    bool found = false;
+    for (const qint32 column : columns) {
+      if (column < 0 || column >= BakFileModel::ColumnCount) continue;
+      const QString *text = item.FoldedText(column);
+      if (text ? Contains(*text, term) : Contains(item.display[column].toString().toCaseFolded(), term)) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) return false;
+  }
+
+  return true;
 
 }
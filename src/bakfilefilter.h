@@ -20,11 +20,30 @@
 #ifndef BAKFILEFILTER_H
 #define BAKFILEFILTER_H
 
+#include <memory>
+#include <atomic>
+
 #include <QtGlobal>
 #include <QObject>
 #include <QSortFilterProxyModel>
 #include <QList>
 #include <QString>
+#include <QHash>
+#include <QBitArray>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+
+#include "bakfilequery.h"
+#include "bakfilemodel.h"
+
+class QAbstractItemModel;
+class BakFileItem;
+
+// Case insensitive filter on the filter key columns, every term of the query must be found in one of the columns.
+// When the filename and file type are the only filter columns, rows the model's search index rules out are rejected with a bit test.
+// When the new query refines the previous one, rows rejected by the previous filter are rejected without matching them again.
+// Passes expected to take longer than a frame are matched in a background thread on a copy of the rows, the results are applied with one filter pass when ready.
+// Until then the previous query stays applied, the filter never matches rows against a query still pending in the background.
 
 class BakFileFilter : public QSortFilterProxyModel {
   Q_OBJECT
@@ -32,14 +51,72 @@ class BakFileFilter : public QSortFilterProxyModel {
  public:
   explicit BakFileFilter(QObject *parent = nullptr);
 
+  void setSourceModel(QAbstractItemModel *source_model) override;
+  void fetchMore(const QModelIndex &parent) override;
   void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
   void setFilterKeyColumns(const QList<qint32> &filter_columns);
- 
+
+  QString filter_text() const { return filter_text_; }
+  void SetFilterText(const QString &text);
+  bool filter_pending() const { return filter_watcher_ != nullptr; }
+
+  static const int kFrameMs;
+  // How long filtering with the text is expected to take, from the measured filter passes.
+  qint64 EstimatedCostMs(const QString &text) const;
+
+  static bool Contains(const QString &haystack, const QString &needle);
+  static bool Matches(const BakFileQuery &query, const QList<qint32> &columns, const BakFileModel::ModelItem &item);
+
  protected:
   bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
- 
+
+ private:
+  // Item version shifted left by one, with the lowest bit set when the item matched.
+  typedef QHash<const BakFileItem*, quint64> MatchResults;
+
+  static const int kFetchMinMatches;
+  static const qint64 kDefaultRowCostNs;
+
+  void UpdateCandidates();
+  bool MatchesRow(const int source_row, const QModelIndex &source_parent) const;
+  quint64 NextGeneration();
+  void ApplyQuery(const BakFileQuery &query, const quint64 generation);
+  void FilterInBackground(const BakFileQuery &query, const quint64 generation);
+  qint64 EstimatedCostMs(const BakFileQuery &query) const;
+  void UpdateRowCost(const bool refined, const qint64 nsecs, const int rows);
+  // Matches the first count items, the rows exposed when the copy was made.
+  static MatchResults MatchItems(const BakFileModel::ModelItemList &items, const int count, const BakFileQuery &query, const QList<qint32> &columns, const quint64 generation, const std::shared_ptr<std::atomic<quint64>> &latest_generation);
+
+ private slots:
+  void FilterFinished();
+
  private:
+  BakFileModel *model_;
   QList<qint32> filter_columns_;
+  QString filter_text_;
+  // The query rows are filtered with, a query matched in the background is applied when the results are ready.
+  BakFileQuery query_;
+  BakFileQuery pending_query_;
+  QBitArray candidates_;
+  bool use_candidates_;
+  quint64 candidates_revision_;
+  // Generation of the applied query, rows rejected since the base generation are still rejected.
+  quint64 generation_;
+  quint64 base_generation_;
+  // Lets a background match give up when the filter text changes again.
+  std::shared_ptr<std::atomic<quint64>> latest_generation_;
+  QFutureWatcher<MatchResults> *filter_watcher_;
+  // Copy of the rows being matched, the results point into it.
+  BakFileModel::ModelItemList pending_items_;
+  int pending_rows_;
+  quint64 pending_generation_;
+  QElapsedTimer pending_timer_;
+  // Results of the background match, only kept while they're applied.
+  MatchResults results_;
+  quint64 results_generation_;
+  // Refined passes skip the rows rejected by the previous query, so they're measured apart from the full passes.
+  qint64 full_row_cost_ns_;
+  qint64 refined_row_cost_ns_;
 };
 
 #endif  // BAKFILEFILTER_H
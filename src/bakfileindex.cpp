@@ -0,0 +1,170 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QBitArray>
+
+#include "bakfileindex.h"
+
+const int BakFileIndex::kTrigramSize = 3;
+
+BakFileIndex::BakFileIndex() : removed_(0), revision_(0) {}
+
+quint64 BakFileIndex::Trigram(const QChar *c) {
+  return (static_cast<quint64>(c[0].unicode()) << 32) | (static_cast<quint64>(c[1].unicode()) << 16) | static_cast<quint64>(c[2].unicode());
+}
+
+void BakFileIndex::Index(const quint32 id) {
+
+  // IDs only grow, so appending keeps the posting lists sorted.
+  const Entry &entry = entries_[id];
+  QSet<quint64> trigrams;
+  for (int i = 0 ; i + kTrigramSize <= entry.filename.size() ; ++i) {
+    trigrams.insert(Trigram(entry.filename.constData() + i));
+  }
+  for (const quint64 trigram : trigrams) {
+    trigrams_[trigram].append(id);
+  }
+  file_types_[entry.file_type].append(id);
+
+}
+
+void BakFileIndex::Add(const BakFileItem *item, const QString &filename_folded, const QString &file_type_folded) {
+
+  if (ids_.contains(item)) Remove(item);
+
+  const quint32 id = static_cast<quint32>(entries_.count());
+  Entry entry;
+  entry.item = item;
+  entry.filename = filename_folded;
+  entry.file_type = file_type_folded;
+  entries_.append(entry);
+  ids_.insert(item, id);
+  Index(id);
+
+}
+
+void BakFileIndex::Remove(const BakFileItem *item) {
+
+  if (!ids_.contains(item)) return;
+
+  const quint32 id = ids_.take(item);
+  entries_[id].item = nullptr;
+  entries_[id].filename.clear();
+  entries_[id].file_type.clear();
+  ++removed_;
+
+  if (removed_ > 1024 && removed_ > ids_.count()) {
+    Rebuild();
+  }
+
+}
+
+void BakFileIndex::Clear() {
+
+  entries_.clear();
+  ids_.clear();
+  trigrams_.clear();
+  file_types_.clear();
+  removed_ = 0;
+  ++revision_;
+
+}
+
+void BakFileIndex::Rebuild() {
+
+  QVector<Entry> entries;
+  entries.reserve(ids_.count());
+  for (const Entry &entry : entries_) {
+    if (entry.item) entries.append(entry);
+  }
+
+  Clear();
+  entries_ = entries;
+  for (quint32 id = 0 ; id < static_cast<quint32>(entries_.count()) ; ++id) {
+    ids_.insert(entries_[id].item, id);
+    Index(id);
+  }
+
+}
+
+QBitArray BakFileIndex::TermCandidates(const QString &term) const {
+
+  QBitArray candidates(entries_.count());
+
+  // Filenames containing every trigram of the term, starting with the shortest posting list.
+  QList<const Postings*> postings;
+  for (int i = 0 ; i + kTrigramSize <= term.size() ; ++i) {
+    QHash<quint64, Postings>::const_iterator it = trigrams_.constFind(Trigram(term.constData() + i));
+    if (it == trigrams_.constEnd()) {
+      postings.clear();
+      break;
+    }
+    postings << &it.value();
+  }
+  if (!postings.isEmpty()) {
+    std::sort(postings.begin(), postings.end(), [](const Postings *a, const Postings *b) { return a->count() < b->count(); });
+    Postings ids = *postings.first();
+    for (int i = 1 ; i < postings.count() && !ids.isEmpty() ; ++i) {
+      Postings intersection;
+      std::set_intersection(ids.constBegin(), ids.constEnd(), postings[i]->constBegin(), postings[i]->constEnd(), std::back_inserter(intersection));
+      ids = intersection;
+    }
+    for (const quint32 id : ids) {
+      candidates.setBit(static_cast<int>(id));
+    }
+  }
+
+  for (QHash<QString, Postings>::const_iterator it = file_types_.constBegin() ; it != file_types_.constEnd() ; ++it) {
+    if (!it.key().contains(term)) continue;
+    for (const quint32 id : it.value()) {
+      candidates.setBit(static_cast<int>(id));
+    }
+  }
+
+  return candidates;
+
+}
+
+bool BakFileIndex::Candidates(const QStringList &terms, QBitArray *candidates) const {
+
+  bool narrowed = false;
+  for (const QString &term : terms) {
+    if (term.size() < kTrigramSize) continue;
+    if (narrowed) {
+      *candidates &= TermCandidates(term);
+    }
+    else {
+      *candidates = TermCandidates(term);
+      narrowed = true;
+    }
+  }
+
+  return narrowed;
+
+}
@@ -0,0 +1,81 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef BAKFILEINDEX_H
+#define BAKFILEINDEX_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QBitArray>
+
+class BakFileItem;
+
+// Trigram index over the case folded filenames, used by the filter to narrow down the rows it has to match.
+// File types are indexed by their distinct values since there are only a handful of them.
+// Removed items leave stale IDs in the posting lists until enough of them pile up to rebuild the index.
+
+class BakFileIndex {
+
+ public:
+  explicit BakFileIndex();
+
+  static const int kTrigramSize;
+
+  void Add(const BakFileItem *item, const QString &filename_folded, const QString &file_type_folded);
+  void Remove(const BakFileItem *item);
+  void Clear();
+
+  int count() const { return ids_.count(); }
+  int id(const BakFileItem *item) const { return ids_.value(item, -1); }
+  // Changes when the IDs are reassigned.
+  quint64 revision() const { return revision_; }
+
+  // Sets the bits of the item IDs that may contain all the case folded terms in the filename or file type.
+  // Returns false when none of the terms are long enough for the index to narrow anything down.
+  bool Candidates(const QStringList &terms, QBitArray *candidates) const;
+
+ private:
+  typedef QVector<quint32> Postings;
+
+  struct Entry {
+    const BakFileItem *item;
+    QString filename;
+    QString file_type;
+  };
+
+  static quint64 Trigram(const QChar *c);
+  void Index(const quint32 id);
+  void Rebuild();
+  QBitArray TermCandidates(const QString &term) const;
+
+ private:
+  QVector<Entry> entries_;
+  QHash<const BakFileItem*, quint32> ids_;
+  QHash<quint64, Postings> trigrams_;
+  QHash<QString, Postings> file_types_;
+  int removed_;
+  quint64 revision_;
+
+};
+
+#endif  // BAKFILEINDEX_H
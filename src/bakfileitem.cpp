@@ -19,20 +19,28 @@
 
 #include <QString>
 #include <QDateTime>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include "bakfileitem.h"
 
-BakFileItem::BakFileItem() : file_size_(0), compressed_(false) {}
+namespace {
+QMutex file_types_mutex;
+QSet<QString> file_types;
+}
+
+BakFileItem::BakFileItem() : file_size_(0), modified_(0), compressed_(false) {}
 BakFileItem::BakFileItem(const QString &filename,
               const quint64 file_size,
               const QDateTime &modified,
               const bool compressed,
               const QString &file_type) :
               filename_(filename),
+              file_type_(InternFileType(file_type)),
               file_size_(file_size),
-              modified_(modified),
-              compressed_(compressed),
-              file_type_(file_type) {
+              modified_(modified.toMSecsSinceEpoch()),
+              compressed_(compressed) {
 
   //qLog(Debug) << "item for" << filename_ << "allocated.";
 
@@ -41,37 +49,42 @@ BakFileItem::~BakFileItem() {
   //qLog(Debug) << "Item for" << filename_ << "released.";
 }
 
+QString BakFileItem::InternFileType(const QString &file_type) {
+
+  // Files are scanned from several threads.
+  QMutexLocker l(&file_types_mutex);
+  QSet<QString>::const_iterator it = file_types.constFind(file_type);
+  if (it != file_types.constEnd()) return *it;
+  file_types.insert(file_type);
+
+  return file_type;
+
+}
+
 void BakFileItem::clear() {
 
   filename_.clear();
   file_size_ = -1;
-  modified_ = QDateTime();
+  modified_ = 0;
   compressed_ = false;
   file_type_.clear();
 
 }
 
-bool BakFileItem::operator==(BakFileItem other) const {
+bool BakFileItem::operator==(const BakFileItem &other) const {
 
   //qLog(Debug) << __PRETTY_FUNCTION__ << filename_ << other.filename();
 
-  return filename_ == other.filename() &&
-         file_size_ == other.file_size() &&
-         modified_ == other.modified() &&
-         compressed_ == other.compressed() &&
-         file_type_ == other.file_type();
+  return filename_ == other.filename_ &&
+         file_size_ == other.file_size_ &&
+         modified_ == other.modified_ &&
+         compressed_ == other.compressed_ &&
+         file_type_ == other.file_type_;
 
 }
 
-bool BakFileItem::operator!=(BakFileItem other) const {
+bool BakFileItem::operator!=(const BakFileItem &other) const {
 
-  //qLog(Debug) << __PRETTY_FUNCTION__ << filename_ << other.filename();
-
-  return filename_ != other.filename() ||
-         file_size_ != other.file_size() ||
-         modified_ != other.modified() ||
-         compressed_ != other.compressed() ||
-         file_type_ != other.file_type();
+  return !(*this == other);
 
 }
-
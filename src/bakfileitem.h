@@ -29,7 +29,10 @@
 #include <QString>
 #include <QDateTime>
 
-class BakFileItem : public std::enable_shared_from_this<BakFileItem> {
+// The modified time is kept as milliseconds since the epoch, so a file rewritten within the same second still compares as changed.
+// The libmagic file type is interned, since most files share one of a few types.
+
+class BakFileItem {
 
  public:
   explicit BakFileItem();
@@ -38,20 +41,24 @@ class BakFileItem : public std::enable_shared_from_this<BakFileItem> {
 
   QString filename() const { return filename_; }
   quint64 file_size() const { return file_size_; }
-  QDateTime modified() const { return modified_; }
+  QDateTime modified() const { return QDateTime::fromMSecsSinceEpoch(modified_); }
+  qint64 modified_msecs() const { return modified_; }
+  qint64 modified_secs() const { return modified_ / 1000; }
   bool compressed() const { return compressed_; }
   QString file_type() const { return file_type_; }
   bool is_valid() const { return true; }
-  bool operator==(BakFileItem other) const;
-  bool operator!=(BakFileItem other) const;
+  bool operator==(const BakFileItem &other) const;
+  bool operator!=(const BakFileItem &other) const;
   void clear();
 
+  static QString InternFileType(const QString &file_type);
+
  protected:
    QString filename_;
+   QString file_type_;
    quint64 file_size_;
-   QDateTime modified_;
+   qint64 modified_;
    bool compressed_;
-   QString file_type_;
 
 };
 
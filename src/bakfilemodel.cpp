@@ -23,10 +23,17 @@
 
 #include <QAbstractListModel>
 #include <QList>
-#include <QMap>
+#include <QVector>
+#include <QHash>
+#include <QSet>
 #include <QVariant>
 #include <QString>
 #include <QDateTime>
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 #include <QFlags>
 #include <QtDebug>
 
@@ -36,7 +43,65 @@
 #include "bakfilemodel.h"
 #include "bakfileitem.h"
 
-BakFileModel::BakFileModel(QObject *parent) : QAbstractListModel(parent), sort_column_(Column_Modified), sort_order_(Qt::AscendingOrder) {}
+// Larger batches are appended and sorted in one go instead of inserted one by one.
+const int BakFileModel::kSortedInsertMax = 64;
+
+// Rows are exposed to the view a page at a time as it scrolls.
+const int BakFileModel::kFetchPageSize = 1000;
+
+// Sorting more rows than this is done in a background thread so the GUI keeps painting.
+const int BakFileModel::kBackgroundSortMin = 20000;
+
+BakFileModel::BakFileModel(QObject *parent) : QAbstractListModel(parent), rows_dirty_(false), fetched_(0), sort_column_(Column_Modified), sort_order_(Qt::AscendingOrder), items_revision_(0), sort_watcher_(nullptr), sort_pending_column_(Column_Modified), sort_pending_order_(Qt::AscendingOrder), sort_pending_revision_(0) {
+
+  collator_.setCaseSensitivity(Qt::CaseInsensitive);
+
+}
+
+BakFileModel::FileTypeKeys::FileTypeKeys(const QString &file_type, const QCollator &collator) :
+  folded(file_type.toCaseFolded()),
+  key(collator.sortKey(file_type.toLower())) {}
+
+BakFileModel::ModelItem::ModelItem(const BakFileItemPtr &_item, const QCollator &collator, const FileTypeKeysPtr &_file_type) :
+  item(_item),
+  filename_key(collator.sortKey(QString())),
+  file_size(0),
+  modified(0),
+  compressed(false),
+  version(0) {
+
+  UpdateKeys(collator, _file_type);
+
+}
+
+void BakFileModel::ModelItem::UpdateKeys(const QCollator &collator, const FileTypeKeysPtr &_file_type) {
+
+  // Not every collator backend supports case insensitive collation, so the keys are made from lowercase strings.
+  filename_key = collator.sortKey(item->filename().toLower());
+  file_type = _file_type;
+  file_size = item->file_size();
+  modified = item->modified_msecs();
+  compressed = item->compressed();
+  filename_folded = item->filename().toCaseFolded();
+  ++version;
+
+  display[Column_Filename] = item->filename();
+  display[Column_FileSize] = Utilities::PrettySize(item->file_size());
+  display[Column_Modified] = item->modified();
+  display[Column_Compressed] = item->compressed();
+  display[Column_FileType] = item->file_type();
+
+}
+
+const QString *BakFileModel::ModelItem::FoldedText(const int column) const {
+
+  switch (column) {
+    case Column_Filename:   return &filename_folded;
+    case Column_FileType:   return &file_type->folded;
+    default:                return nullptr;
+  }
+
+}
 
 QString BakFileModel::column_name(const Column column) {
 
@@ -66,30 +131,9 @@ QVariant BakFileModel::headerData(int section, Qt::Orientation, int role) const
 
 QVariant BakFileModel::data(const QModelIndex &idx, int role) const {
 
-  if (!idx.isValid()) return QVariant();
-
-  BakFileItemPtr item = items_[idx.row()];
-  switch (role) {
-    case Qt::DisplayRole:
-      switch (idx.column()) {
-        case Column_Filename:
-          return item->filename();
-        case Column_FileSize:
-          return Utilities::PrettySize(item->file_size());
-        case Column_Modified:
-          return item->modified();
-        case Column_Compressed:
-          return item->compressed();
-        case Column_FileType:
-          return item->file_type();
-        default:
-          break;
-      }
-    default:
-      break;
-  }
+  if (!idx.isValid() || role != Qt::DisplayRole || idx.column() < 0 || idx.column() >= ColumnCount) return QVariant();
 
-  return QVariant();
+  return items_[idx.row()].display[idx.column()];
 
 }
 
@@ -103,107 +147,342 @@ Qt::ItemFlags BakFileModel::flags(const QModelIndex &index) const {
 
 }
 
+bool BakFileModel::canFetchMore(const QModelIndex &parent) const {
+
+  return !parent.isValid() && fetched_ < items_.count();
+
+}
+
+void BakFileModel::fetchMore(const QModelIndex &parent) {
+
+  if (parent.isValid()) return;
+
+  FetchRows(qMin(items_.count(), fetched_ + kFetchPageSize));
+
+}
+
+void BakFileModel::FetchAll() {
+
+  FetchRows(items_.count());
+
+}
+
+void BakFileModel::FetchRows(const int count) {
+
+  if (count <= fetched_) return;
+
+  beginInsertRows(QModelIndex(), fetched_, count - 1);
+  fetched_ = count;
+  endInsertRows();
+
+}
+
 void BakFileModel::sort(int column, Qt::SortOrder order) {
 
-  sort_column_ = column;
-  sort_order_ = order;
+  if (items_.count() < kBackgroundSortMin) {
+    sort_watcher_ = nullptr;
+    ApplySort(column, order, SortedItems(items_, column, order));
+    return;
+  }
+
+  // The rows keep their current order until the sorted copy is ready, a newer sort replaces the pending one.
+  sort_pending_column_ = column;
+  sort_pending_order_ = order;
+  sort_pending_revision_ = items_revision_;
+  sort_watcher_ = new QFutureWatcher<ModelItemList>(this);
+  connect(sort_watcher_, &QFutureWatcherBase::finished, this, &BakFileModel::SortFinished);
+  sort_watcher_->setFuture(QtConcurrent::run(&BakFileModel::SortedItems, items_, column, order));
+
+}
 
-  BakFileItemList new_items(items_);
-  BakFileItemList::iterator begin = new_items.begin();
+void BakFileModel::SortFinished() {
 
-  if (column == Column_Filename) {
-    std::stable_sort(begin, new_items.end(), std::bind(&BakFileModel::CompareItems, Column_Modified, order, std::placeholders::_1, std::placeholders::_2));
-    std::stable_sort(begin, new_items.end(), std::bind(&BakFileModel::CompareItems, Column_Filename, order, std::placeholders::_1, std::placeholders::_2));
+  QFutureWatcher<ModelItemList> *watcher = static_cast<QFutureWatcher<ModelItemList>*>(sender());
+  watcher->deleteLater();
+  if (watcher != sort_watcher_) return;
+  sort_watcher_ = nullptr;
+
+  // Rows were added, updated or removed while sorting, the copy is out of date.
+  if (sort_pending_revision_ != items_revision_) {
+    sort(sort_pending_column_, sort_pending_order_);
+    return;
   }
-  else {
-    std::stable_sort(begin, new_items.end(), std::bind(&BakFileModel::CompareItems, column, order, std::placeholders::_1, std::placeholders::_2));
+
+  ApplySort(sort_pending_column_, sort_pending_order_, watcher->result());
+
+}
+
+BakFileModel::ModelItemList BakFileModel::SortedItems(ModelItemList items, const int column, const Qt::SortOrder order) {
+
+  std::stable_sort(items.begin(), items.end(), [column, order](const ModelItem &a, const ModelItem &b) { return CompareItems(column, order, a, b); });
+
+  return items;
+
+}
+
+void BakFileModel::ApplySort(const int column, const Qt::SortOrder order, const ModelItemList &new_items) {
+
+  sort_column_ = column;
+  sort_order_ = order;
+
+  // Selected rows must stay exposed, so rows are fetched up to the last row they move to before the layout changes.
+  const QModelIndexList persistent_indexes = persistentIndexList();
+  if (!persistent_indexes.isEmpty()) {
+    QSet<const BakFileItem*> persistent_items;
+    for (const QModelIndex &idx : persistent_indexes) {
+      persistent_items.insert(items_[idx.row()].item.get());
+    }
+    int last_row = -1;
+    for (int row = 0 ; row < new_items.count() ; ++row) {
+      if (persistent_items.contains(new_items[row].item.get())) last_row = row;
+    }
+    FetchRows(last_row + 1);
   }
 
   emit layoutAboutToBeChanged();
 
-  BakFileItemList old_items = items_;
+  // The rejected generations follow their rows, looked up while the rows are still in the old order.
+  QVector<quint64> rejected_generations(new_items.count(), 0);
+  for (int row = 0 ; row < new_items.count() ; ++row) {
+    const int old_row = RowOf(new_items[row].item);
+    if (old_row != -1) rejected_generations[row] = rejected_generations_[old_row];
+  }
+  rejected_generations_ = rejected_generations;
+
+  ModelItemList old_items = items_;
   items_ = new_items;
 
-  QMap<const BakFileItem*, int> new_rows;
-  for (int i = 0; i < new_items.length() ; ++i) {
-    new_rows[new_items[i].get()] = i;
-  }
+  rows_dirty_ = true;
+  IndexRows(0, items_.count() - 1);
 
   for (const QModelIndex &idx : persistentIndexList()) {
-    const BakFileItem *item = old_items[idx.row()].get();
-    changePersistentIndex(idx, index(new_rows[item], idx.column(), idx.parent()));
+    const BakFileItem *item = old_items[idx.row()].item.get();
+    changePersistentIndex(idx, index(rows_.value(item), idx.column(), idx.parent()));
   }
 
   emit layoutChanged();
 
 }
 
-bool BakFileModel::CompareItems(const int column, const Qt::SortOrder order, std::shared_ptr<BakFileItem> _a, std::shared_ptr<BakFileItem> _b) {
+bool BakFileModel::CompareItems(const int column, const Qt::SortOrder order, const ModelItem &_a, const ModelItem &_b) {
 
-  std::shared_ptr<BakFileItem> a = order == Qt::AscendingOrder ? _a : _b;
-  std::shared_ptr<BakFileItem> b = order == Qt::AscendingOrder ? _b : _a;
+  const ModelItem &a = order == Qt::AscendingOrder ? _a : _b;
+  const ModelItem &b = order == Qt::AscendingOrder ? _b : _a;
 
+  int cmp = 0;
   switch (column) {
-    case Column_Filename:     return QString::localeAwareCompare(a->filename().toLower(), b->filename().toLower()) < 0;
-    case Column_FileSize:     return a->file_size() < b->file_size();
-    case Column_Modified:     return a->modified() < b->modified();
-    case Column_Compressed:   return a->compressed() == b->compressed();
-    case Column_FileType:     return QString::localeAwareCompare(a->file_type().toLower(), b->file_type().toLower()) < 0;
-    default:                  qLog(Error) << "No such column" << column;
+    case Column_Filename:     cmp = a.filename_key.compare(b.filename_key); break;
+    case Column_FileSize:     cmp = a.file_size < b.file_size ? -1 : (a.file_size > b.file_size ? 1 : 0); break;
+    case Column_Modified:     cmp = a.modified < b.modified ? -1 : (a.modified > b.modified ? 1 : 0); break;
+    case Column_Compressed:   cmp = static_cast<int>(a.compressed) - static_cast<int>(b.compressed); break;
+    case Column_FileType:     cmp = a.file_type == b.file_type ? 0 : a.file_type->key.compare(b.file_type->key); break;
+    default:                  qLog(Error) << "No such column" << column; return false;
   }
+  if (cmp != 0) return cmp < 0;
+
+  // Files with the same name are ordered by date.
+  if (column == Column_Filename) return a.modified < b.modified;
 
   return false;
 
 }
 
+int BakFileModel::InsertPosition(const ModelItem &item) const {
+
+  // Insert after equal items, like the stable sort would.
+  return static_cast<int>(std::upper_bound(items_.begin(), items_.end(), item, [this](const ModelItem &a, const ModelItem &b) { return LessThan(a, b); }) - items_.begin());
+
+}
+
+BakFileModel::FileTypeKeysPtr BakFileModel::FileTypeKeysFor(const QString &file_type) {
+
+  QHash<QString, FileTypeKeysPtr>::const_iterator it = file_types_.constFind(file_type);
+  if (it != file_types_.constEnd()) return it.value();
+
+  FileTypeKeysPtr keys = std::make_shared<const FileTypeKeys>(file_type, collator_);
+  file_types_.insert(file_type, keys);
+
+  return keys;
+
+}
+
+int BakFileModel::RowOf(const BakFileItemPtr &item) const {
+
+  if (rows_dirty_) {
+    rows_.clear();
+    rows_.reserve(items_.count());
+    for (int row = 0 ; row < items_.count() ; ++row) {
+      rows_.insert(items_[row].item.get(), row);
+    }
+    rows_dirty_ = false;
+  }
+
+  return rows_.value(item.get(), -1);
+
+}
+
+void BakFileModel::IndexRows(const int first, const int last) {
+
+  if (rows_dirty_ && (first != 0 || last != items_.count() - 1)) return;
+
+  if (first == 0 && last == items_.count() - 1) {
+    rows_.clear();
+    rows_.reserve(items_.count());
+  }
+  for (int row = first ; row <= last ; ++row) {
+    rows_.insert(items_[row].item.get(), row);
+  }
+  rows_dirty_ = false;
+
+}
+
+void BakFileModel::MoveToSortedPosition(const int row) {
+
+  const bool before_ok = row == 0 || !LessThan(items_[row], items_[row - 1]);
+  const bool after_ok = row == items_.count() - 1 || !LessThan(items_[row + 1], items_[row]);
+  if (before_ok && after_ok) return;
+
+  ModelItem item = items_.takeAt(row);
+  const int new_row = InsertPosition(item);
+  items_.insert(row, item);
+
+  // A row moving into or out of the exposed rows is inserted or removed instead.
+  if (row < fetched_ && new_row < fetched_) {
+    // beginMoveRows() takes the destination before the row is removed.
+    if (beginMoveRows(QModelIndex(), row, row, QModelIndex(), new_row > row ? new_row + 1 : new_row)) {
+      items_.move(row, new_row);
+      rejected_generations_.move(row, new_row);
+      IndexRows(qMin(row, new_row), qMax(row, new_row));
+      endMoveRows();
+    }
+  }
+  else if (row < fetched_) {
+    beginRemoveRows(QModelIndex(), row, row);
+    items_.move(row, new_row);
+    rejected_generations_.move(row, new_row);
+    IndexRows(qMin(row, new_row), qMax(row, new_row));
+    --fetched_;
+    endRemoveRows();
+  }
+  else if (new_row < fetched_) {
+    beginInsertRows(QModelIndex(), new_row, new_row);
+    items_.move(row, new_row);
+    rejected_generations_.move(row, new_row);
+    IndexRows(qMin(row, new_row), qMax(row, new_row));
+    ++fetched_;
+    endInsertRows();
+  }
+  else {
+    items_.move(row, new_row);
+    rejected_generations_.move(row, new_row);
+    IndexRows(qMin(row, new_row), qMax(row, new_row));
+  }
+
+}
+
 void BakFileModel::AddedFiles(BakFileItemList items) {
 
-  const int pos = -1;
+  if (items.isEmpty()) return;
+  ++items_revision_;
 
-  const int start = pos == -1 ? items_.count() : pos;
-  const int end = start + items.count() - 1;
+  ModelItemList new_items;
+  new_items.reserve(items.count());
+  for (const BakFileItemPtr &item : items) {
+    new_items << ModelItem(item, collator_, FileTypeKeysFor(item->file_type()));
+  }
+  std::stable_sort(new_items.begin(), new_items.end(), [this](const ModelItem &a, const ModelItem &b) { return LessThan(a, b); });
+  for (const ModelItem &item : new_items) {
+    search_index_.Add(item.item.get(), item.filename_folded, item.file_type->folded);
+  }
 
-  beginInsertRows(QModelIndex(), start, end);
-  for (int i = start; i <= end; ++i) {
-    BakFileItemPtr item = items[i - start];
-    items_.insert(i, item);
+  // The initial scan fills the empty model and exposes the first page with one insert.
+  if (items_.isEmpty()) {
+    items_ = new_items;
+    rejected_generations_.fill(0, items_.count());
+    IndexRows(0, items_.count() - 1);
+    FetchRows(qMin(items_.count(), kFetchPageSize));
+    return;
   }
-  endInsertRows();
 
-  emit dataChanged(index(0, 0), index(rowCount() - 1, 0));
+  // Rows past the exposed ones are added without telling the view.
+  if (new_items.count() > kSortedInsertMax) {
+    const int start = items_.count();
+    items_.append(new_items);
+    rejected_generations_.resize(items_.count());
+    IndexRows(start, items_.count() - 1);
+    FetchRows(qMin(items_.count(), kFetchPageSize));
+    // A pending sort starts over with the new rows when it finishes.
+    if (!sort_watcher_) sort(sort_column_, sort_order_);
+    return;
+  }
 
-  sort(sort_column_, sort_order_);
+  for (const ModelItem &item : new_items) {
+    const int row = InsertPosition(item);
+    const bool exposed = row < fetched_ || (row == fetched_ && fetched_ < kFetchPageSize);
+    if (exposed) beginInsertRows(QModelIndex(), row, row);
+    items_.insert(row, item);
+    rejected_generations_.insert(row, 0);
+    rows_dirty_ = true;
+    if (exposed) {
+      ++fetched_;
+      endInsertRows();
+    }
+  }
 
 }
 
 void BakFileModel::UpdatedFiles(BakFileItemList items) {
 
-  QList<BakFileItemPtr>::iterator i = items.begin();
-  while (i != items.end()) {
-    if (items_.contains(*i)) {
-      int item_pos = items_.indexOf(*i);
-      emit dataChanged(index(item_pos, 0), index(item_pos, ColumnCount - 1));
-    }
-    ++i;
+  ++items_revision_;
+
+  for (const BakFileItemPtr &item : items) {
+    const int item_pos = RowOf(item);
+    if (item_pos == -1) continue;
+    items_[item_pos].UpdateKeys(collator_, FileTypeKeysFor(item->file_type()));
+    rejected_generations_[item_pos] = 0;
+    search_index_.Add(item.get(), items_[item_pos].filename_folded, items_[item_pos].file_type->folded);
+    if (item_pos < fetched_) emit dataChanged(index(item_pos, 0), index(item_pos, ColumnCount - 1));
+    MoveToSortedPosition(item_pos);
   }
 
 }
 
 void BakFileModel::DeletedFiles(BakFileItemList items) {
 
-  QList<BakFileItemPtr>::iterator i = items.begin();
-  while (i != items.end()) {
-    if (items_.contains(*i)) {
-      BakFileItemPtr item = *i;
-      int item_pos = items_.indexOf(*i);
-      beginRemoveRows(QModelIndex(), item_pos, item_pos);
-      items_.removeAll(*i);
-      endRemoveRows();
-      QModelIndex idx_topleft = index(item_pos, 0);
-      QModelIndex idx_bottomright = index(item_pos, rowCount() - 1);
-      emit dataChanged(idx_topleft, idx_bottomright);
+  QList<int> rows;
+  rows.reserve(items.count());
+  for (const BakFileItemPtr &item : items) {
+    const int row = RowOf(item);
+    if (row != -1) rows << row;
+  }
+  if (rows.isEmpty()) return;
+  ++items_revision_;
+
+  // Remove contiguous rows together, from the bottom so the rows above keep their position.
+  std::sort(rows.begin(), rows.end(), std::greater<int>());
+  rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+  int i = 0;
+  while (i < rows.count()) {
+    const int last = rows[i];
+    int first = last;
+    while (i + 1 < rows.count() && rows[i + 1] == first - 1) {
+      first = rows[++i];
     }
     ++i;
+    // Only the exposed part of the run is removed from the view.
+    const int exposed_last = qMin(last, fetched_ - 1);
+    if (first <= exposed_last) beginRemoveRows(QModelIndex(), first, exposed_last);
+    for (int row = first ; row <= last ; ++row) {
+      search_index_.Remove(items_[row].item.get());
+    }
+    items_.erase(items_.begin() + first, items_.begin() + last + 1);
+    rejected_generations_.remove(first, last - first + 1);
+    rows_dirty_ = true;
+    if (first <= exposed_last) {
+      fetched_ -= exposed_last - first + 1;
+      endRemoveRows();
+    }
   }
 
 }
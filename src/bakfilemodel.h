@@ -26,10 +26,17 @@
 #include <QObject>
 #include <QAbstractItemModel>
 #include <QAbstractListModel>
+#include <QList>
+#include <QVector>
+#include <QHash>
 #include <QVariant>
 #include <QString>
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QFutureWatcher>
 
 #include "bakfileitem.h"
+#include "bakfileindex.h"
 
 class BakFileModel : public QAbstractListModel {
   Q_OBJECT
@@ -47,28 +54,104 @@ class BakFileModel : public QAbstractListModel {
   };
   static QString column_name(const Column column);
 
-  const BakFileItemPtr &item_at(const int idx) const { return items_[idx]; }
+  // Case folded text and collation key of a file type, made once for each distinct type and shared by the rows of that type.
+  struct FileTypeKeys {
+    explicit FileTypeKeys(const QString &file_type, const QCollator &collator);
+    QString folded;
+    QCollatorSortKey key;
+  };
+  typedef std::shared_ptr<const FileTypeKeys> FileTypeKeysPtr;
+
+  // The collation keys are created once when a file enters the model, so sorting doesn't collate strings on every comparison.
+  // The other sort keys are copied in as well, so comparisons don't have to follow the item pointer.
+  // The case folded filename is kept for the filter, the file type keys are shared.
+  // The display values are made at the same time, the view asks for them on every paint.
+  // The version counts the updates, so results computed on a copy of the rows can tell if the item changed since.
+  struct ModelItem {
+    explicit ModelItem(const BakFileItemPtr &_item, const QCollator &collator, const FileTypeKeysPtr &_file_type);
+    void UpdateKeys(const QCollator &collator, const FileTypeKeysPtr &_file_type);
+    // Case folded text of the filename and file type columns, nullptr for the other columns.
+    const QString *FoldedText(const int column) const;
+    BakFileItemPtr item;
+    QCollatorSortKey filename_key;
+    FileTypeKeysPtr file_type;
+    quint64 file_size;
+    // Milliseconds since the epoch.
+    qint64 modified;
+    bool compressed;
+    QString filename_folded;
+    quint32 version;
+    QVariant display[ColumnCount];
+  };
+  typedef QList<ModelItem> ModelItemList;
+
+  const BakFileItemPtr &item_at(const int idx) const { return items_[idx].item; }
+  const ModelItem &model_item(const int row) const { return items_[row]; }
+  // Implicitly shared copy of all the rows, for work done in another thread.
+  ModelItemList model_items() const { return items_; }
+
+  // Filter generation that last rejected the row, kept apart from the rows so the copies handed to other threads are never written to.
+  quint64 rejected_generation(const int row) const { return rejected_generations_[row]; }
+  void set_rejected_generation(const int row, const quint64 generation) const { rejected_generations_[row] = generation; }
 
-  int rowCount(const QModelIndex &parent = QModelIndex()) const override { Q_UNUSED(parent); return items_.size(); }
+  const BakFileIndex &search_index() const { return search_index_; }
+
+  // Only the fetched rows are exposed, the view fetches more as it scrolls.
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override { Q_UNUSED(parent); return fetched_; }
+  int item_count() const { return items_.count(); }
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+  void FetchAll();
   void sort(int column, Qt::SortOrder order) override;
+  bool sort_pending() const { return sort_watcher_ != nullptr; }
 
  private:
   QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
   QVariant data(const QModelIndex &idx, int role) const override;
   int columnCount(const QModelIndex &parent = QModelIndex()) const override { Q_UNUSED(parent); return ColumnCount; }
-  void InsertFileItems(const BakFileItemList &items_in);
   Qt::ItemFlags flags(const QModelIndex &index) const override;
-  static bool CompareItems(const int column, const Qt::SortOrder order, std::shared_ptr<BakFileItem> _a, std::shared_ptr<BakFileItem> _b);
+
+  static const int kSortedInsertMax;
+  static const int kFetchPageSize;
+  static const int kBackgroundSortMin;
+
+  static bool CompareItems(const int column, const Qt::SortOrder order, const ModelItem &_a, const ModelItem &_b);
+  bool LessThan(const ModelItem &a, const ModelItem &b) const { return CompareItems(sort_column_, sort_order_, a, b); }
+  int InsertPosition(const ModelItem &item) const;
+  int RowOf(const BakFileItemPtr &item) const;
+  FileTypeKeysPtr FileTypeKeysFor(const QString &file_type);
+  void IndexRows(const int first, const int last);
+  void MoveToSortedPosition(const int row);
+  void FetchRows(const int count);
+  static ModelItemList SortedItems(ModelItemList items, const int column, const Qt::SortOrder order);
+  void ApplySort(const int column, const Qt::SortOrder order, const ModelItemList &new_items);
 
  public slots:
   void AddedFiles(BakFileItemList);
   void UpdatedFiles(BakFileItemList);
   void DeletedFiles(BakFileItemList);
 
+ private slots:
+  void SortFinished();
+
  private:
-  BakFileItemList items_;
+  QCollator collator_;
+  QHash<QString, FileTypeKeysPtr> file_types_;
+  ModelItemList items_;
+  mutable QVector<quint64> rejected_generations_;
+  // Row of each item, rebuilt on the next lookup after rows are inserted or removed.
+  mutable QHash<const BakFileItem*, int> rows_;
+  mutable bool rows_dirty_;
+  int fetched_;
+  BakFileIndex search_index_;
   int sort_column_;
   Qt::SortOrder sort_order_;
+  // Counts changes to the rows, a background sort of an older copy is started again.
+  quint64 items_revision_;
+  QFutureWatcher<ModelItemList> *sort_watcher_;
+  int sort_pending_column_;
+  Qt::SortOrder sort_pending_order_;
+  quint64 sort_pending_revision_;
 
 };
 
@@ -0,0 +1,199 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <QtGlobal>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QDate>
+#include <QDateTime>
+
+#include "bakfilequery.h"
+#include "bakfileitem.h"
+
+BakFileQuery::BakFileQuery(const QString &text) {
+
+  for (const QString &token : Split(text)) {
+    const int colon = token.indexOf(QLatin1Char(':'));
+    if (colon > 0) {
+      const QString key = token.left(colon).toLower();
+      QString value = token.mid(colon + 1);
+      Predicate predicate;
+      if (key == QLatin1String("size") && ParseOperator(&value, &predicate.op) && ParseSize(value, &predicate.value)) {
+        predicate.date = false;
+        predicates_ << predicate;
+        continue;
+      }
+      if (key == QLatin1String("date") && ParseOperator(&value, &predicate.op) && ParseDate(value, &predicate.op, &predicate.value)) {
+        predicate.date = true;
+        predicates_ << predicate;
+        continue;
+      }
+    }
+    // Anything that isn't a valid predicate is matched as text.
+    terms_ << token.toCaseFolded();
+  }
+
+}
+
+QStringList BakFileQuery::Split(const QString &text) {
+
+  QStringList tokens;
+  QString token;
+  bool quoted = false;
+  for (const QChar c : text) {
+    if (c == QLatin1Char('"')) {
+      quoted = !quoted;
+    }
+    else if (c.isSpace() && !quoted) {
+      if (!token.isEmpty()) tokens << token;
+      token.clear();
+    }
+    else {
+      token.append(c);
+    }
+  }
+  if (!token.isEmpty()) tokens << token;
+
+  return tokens;
+
+}
+
+bool BakFileQuery::ParseOperator(QString *text, Operator *op) {
+
+  if (text->startsWith(QLatin1String("<="))) *op = Operator::LessEqual;
+  else if (text->startsWith(QLatin1String(">="))) *op = Operator::GreaterEqual;
+  else if (text->startsWith(QLatin1Char('<'))) *op = Operator::Less;
+  else if (text->startsWith(QLatin1Char('>'))) *op = Operator::Greater;
+  else return false;
+
+  text->remove(0, (*op == Operator::LessEqual || *op == Operator::GreaterEqual) ? 2 : 1);
+
+  return !text->isEmpty();
+
+}
+
+bool BakFileQuery::ParseSize(const QString &text, qint64 *value) {
+
+  QString number = text.toUpper();
+  if (number.endsWith(QLatin1Char('B'))) number.chop(1);
+
+  qint64 multiplier = 1;
+  if (!number.isEmpty()) {
+    switch (number.at(number.size() - 1).toLatin1()) {
+      case 'K': multiplier = Q_INT64_C(1) << 10; break;
+      case 'M': multiplier = Q_INT64_C(1) << 20; break;
+      case 'G': multiplier = Q_INT64_C(1) << 30; break;
+      case 'T': multiplier = Q_INT64_C(1) << 40; break;
+      default: break;
+    }
+    if (multiplier != 1) number.chop(1);
+  }
+
+  bool ok = false;
+  const double size = number.toDouble(&ok);
+  if (!ok || size < 0) return false;
+  *value = static_cast<qint64>(size * static_cast<double>(multiplier));
+
+  return true;
+
+}
+
+bool BakFileQuery::ParseDate(const QString &text, Operator *op, qint64 *value) {
+
+  // Absolute dates compare against the start of the day.
+  const QDate date = QDate::fromString(text, Qt::ISODate);
+  if (date.isValid()) {
+    *value = QDateTime(date, QTime(0, 0)).toSecsSinceEpoch();
+    return true;
+  }
+
+  // Relative ages: date:<7d is newer than 7 days, so the operator is flipped to compare the modified time.
+  qint64 unit = 0;
+  switch (text.at(text.size() - 1).toLower().toLatin1()) {
+    case 'h': unit = 3600; break;
+    case 'd': unit = 86400; break;
+    case 'w': unit = 604800; break;
+    default: return false;
+  }
+  bool ok = false;
+  const qint64 age = text.left(text.size() - 1).toLongLong(&ok);
+  if (!ok || age < 0) return false;
+  *value = QDateTime::currentSecsSinceEpoch() - age * unit;
+
+  switch (*op) {
+    case Operator::Less: *op = Operator::Greater; break;
+    case Operator::LessEqual: *op = Operator::GreaterEqual; break;
+    case Operator::Greater: *op = Operator::Less; break;
+    case Operator::GreaterEqual: *op = Operator::LessEqual; break;
+  }
+
+  return true;
+
+}
+
+bool BakFileQuery::Compare(const Operator op, const qint64 a, const qint64 b) {
+
+  switch (op) {
+    case Operator::Less: return a < b;
+    case Operator::LessEqual: return a <= b;
+    case Operator::Greater: return a > b;
+    case Operator::GreaterEqual: return a >= b;
+  }
+
+  return false;
+
+}
+
+bool BakFileQuery::MatchesPredicates(const BakFileItem &item) const {
+
+  return MatchesPredicates(item.file_size(), item.modified_secs());
+
+}
+
+bool BakFileQuery::MatchesPredicates(const quint64 file_size, const qint64 modified) const {
+
+  for (const Predicate &predicate : predicates_) {
+    const qint64 value = predicate.date ? modified : static_cast<qint64>(file_size);
+    if (!Compare(predicate.op, value, predicate.value)) return false;
+  }
+
+  return true;
+
+}
+
+bool BakFileQuery::Refines(const BakFileQuery &previous) const {
+
+  // Relative dates move with the clock, so only text-only queries are compared.
+  if (previous.is_empty() || previous.has_predicates() || has_predicates()) return false;
+
+  for (const QString &previous_term : previous.terms()) {
+    bool contained = false;
+    for (const QString &term : terms_) {
+      if (term.contains(previous_term)) {
+        contained = true;
+        break;
+      }
+    }
+    if (!contained) return false;
+  }
+
+  return true;
+
+}
@@ -0,0 +1,74 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef BAKFILEQUERY_H
+#define BAKFILEQUERY_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+class BakFileItem;
+
+// Filter text split into case folded terms, which must all match, and size:/date: predicates.
+// Quoted text is kept as one term, e.g. "cust 123" 2026-10 size:>10G date:<7d
+
+class BakFileQuery {
+
+ public:
+  explicit BakFileQuery(const QString &text = QString());
+
+  bool is_empty() const { return terms_.isEmpty() && predicates_.isEmpty(); }
+  const QStringList &terms() const { return terms_; }
+  bool has_predicates() const { return !predicates_.isEmpty(); }
+
+  bool MatchesPredicates(const BakFileItem &item) const;
+  bool MatchesPredicates(const quint64 file_size, const qint64 modified) const;
+
+  // True when every file rejected by the previous query is rejected by this query too.
+  bool Refines(const BakFileQuery &previous) const;
+
+ private:
+  enum class Operator {
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+  };
+  struct Predicate {
+    bool date;
+    Operator op;
+    qint64 value;
+  };
+
+  static QStringList Split(const QString &text);
+  static bool ParseOperator(QString *text, Operator *op);
+  static bool ParseSize(const QString &text, qint64 *value);
+  static bool ParseDate(const QString &text, Operator *op, qint64 *value);
+  static bool Compare(const Operator op, const qint64 a, const qint64 b);
+
+ private:
+  QStringList terms_;
+  QList<Predicate> predicates_;
+
+};
+
+#endif  // BAKFILEQUERY_H
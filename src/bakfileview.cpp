@@ -56,6 +56,9 @@ void BakFileView::Init() {
 }
 
 void BakFileView::SelectAll() {
+  while (model()->canFetchMore(QModelIndex())) {
+    model()->fetchMore(QModelIndex());
+  }
   selectAll();
 }
 
@@ -34,8 +34,9 @@
 #include "bakfilefilter.h"
 #include "ui_bakfileviewcontainer.h"
 
-const int BakFileViewContainer::kFilterDelayMs = 100;
-const int BakFileViewContainer::kFilterDelaySizeThreshold = 100;
+// Bounds of the delay before filtering while typing, the delay follows the expected cost of the filter pass.
+const int BakFileViewContainer::kFilterDelayMinMs = 50;
+const int BakFileViewContainer::kFilterDelayMaxMs = 300;
 
 BakFileViewContainer::BakFileViewContainer(QWidget *parent)
     : QWidget(parent),
@@ -49,7 +50,7 @@ BakFileViewContainer::BakFileViewContainer(QWidget *parent)
   ui_->toolbar->setStyleSheet("QFrame { border: 0px; }");
 
   filter_timer_->setSingleShot(true);
-  filter_timer_->setInterval(kFilterDelayMs);
+  filter_timer_->setInterval(kFilterDelayMinMs);
   connect(filter_timer_, &QTimer::timeout, this, &BakFileViewContainer::UpdateFilter);
   connect(ui_->filter, &QSearchField::textChanged, this, &BakFileViewContainer::MaybeUpdateFilter);
   ui_->filter->installEventFilter(this);
@@ -67,20 +68,20 @@ void BakFileViewContainer::Init(BakFileModel *model, BakFileFilter *proxy) {
   proxy_->setFilterKeyColumns(QList<qint32>() << BakFileModel::Column_Filename << BakFileModel::Column_FileType);
   proxy_->sort(BakFileModel::Column_Modified, Qt::AscendingOrder);
 
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-  ui_->filter->setText(proxy_->filterRegularExpression().pattern());
-#else
-  ui_->filter->setText(proxy_->filterRegExp().pattern());
-#endif
+  ui_->filter->setText(proxy_->filter_text());
 
 }
 
 void BakFileViewContainer::MaybeUpdateFilter() {
 
-  if (model_->rowCount() < kFilterDelaySizeThreshold || ui_->filter->text().isEmpty()) {
+  // Filters that fit in a frame are applied on every key.
+  const qint64 cost_ms = proxy_->EstimatedCostMs(ui_->filter->text());
+  if (cost_ms <= BakFileFilter::kFrameMs || ui_->filter->text().isEmpty()) {
+    filter_timer_->stop();
     UpdateFilter();
   }
   else {
+    filter_timer_->setInterval(static_cast<int>(qBound(static_cast<qint64>(kFilterDelayMinMs), cost_ms, static_cast<qint64>(kFilterDelayMaxMs))));
     filter_timer_->start();
   }
 
@@ -88,7 +89,7 @@ void BakFileViewContainer::MaybeUpdateFilter() {
 
 void BakFileViewContainer::UpdateFilter() {
 
-  proxy_->setFilterFixedString(ui_->filter->text());
+  proxy_->SetFilterText(ui_->filter->text());
 
 }
 
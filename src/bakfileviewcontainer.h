@@ -50,8 +50,8 @@ class BakFileViewContainer : public QWidget {
   void FocusOnFilter(QKeyEvent*);
 
  private:
-  static const int kFilterDelayMs;
-  static const int kFilterDelaySizeThreshold;
+  static const int kFilterDelayMinMs;
+  static const int kFilterDelayMaxMs;
 
   Ui_BakFileViewContainer *ui_;
   BakFileModel *model_;
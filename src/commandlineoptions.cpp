@@ -26,17 +26,112 @@
 #include <QDataStream>
 #include <QBuffer>
 #include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QDateTime>
+#include <QFileInfo>
 
 #include "commandlineoptions.h"
+#include "restorequeue.h"
 #include "logging.h"
 
-CommandlineOptions::CommandlineOptions() : nothing_(false) {}
+CommandlineOptions::CommandlineOptions() : restore_(false), parallel_(1), json_(false), order_(RestoreQueue::Order_FIFO) {}
 
 bool CommandlineOptions::Parse() {
 
   QCommandLineParser parser;
+  parser.setApplicationDescription(QCoreApplication::translate("CommandlineOptions", "Restore MSSQL backups.\n\nWith --restore the files are restored without showing the window. The exit code is 0 when all files were restored, 1 on invalid arguments or settings and 2 when one or more restores failed."));
+  parser.addHelpOption();
   parser.addVersionOption();
+
+  QCommandLineOption restore_option(QStringList() << "r" << "restore", QCoreApplication::translate("CommandlineOptions", "Restore the given backup files from the local backup path and exit."));
+  QCommandLineOption parallel_option(QStringList() << "p" << "parallel", QCoreApplication::translate("CommandlineOptions", "Number of restores to run at the same time on each server."), QCoreApplication::translate("CommandlineOptions", "count"), "1");
+  QCommandLineOption target_option(QStringList() << "t" << "target", QCoreApplication::translate("CommandlineOptions", "SQL server to restore to, can be given more than once to restore each backup to several servers. Use \"all\" for all configured servers."), QCoreApplication::translate("CommandlineOptions", "server"));
+  QCommandLineOption json_option(QStringList() << "j" << "json", QCoreApplication::translate("CommandlineOptions", "Print progress and results as JSON, one object per line."));
+  QCommandLineOption order_option(QStringList() << "o" << "order", QCoreApplication::translate("CommandlineOptions", "Order of the restores with the same priority: \"fifo\" for the given order, \"smallest\" for the smallest files first or \"deadline\" for the earliest deadline first."), QCoreApplication::translate("CommandlineOptions", "order"), "fifo");
+  QCommandLineOption priority_option(QStringList() << "priority", QCoreApplication::translate("CommandlineOptions", "Priority of a backup file, given as file=priority, files with a higher priority are restored first. Can be given more than once."), QCoreApplication::translate("CommandlineOptions", "file=priority"));
+  QCommandLineOption deadline_option(QStringList() << "deadline", QCoreApplication::translate("CommandlineOptions", "Deadline of a backup file, given as file=yyyy-MM-ddTHH:mm, used with --order deadline. Can be given more than once."), QCoreApplication::translate("CommandlineOptions", "file=time"));
+  parser.addOption(restore_option);
+  parser.addOption(parallel_option);
+  parser.addOption(json_option);
+  parser.addOption(target_option);
+  parser.addOption(order_option);
+  parser.addOption(priority_option);
+  parser.addOption(deadline_option);
+  parser.addPositionalArgument("files", QCoreApplication::translate("CommandlineOptions", "Backup files to restore."), "[files...]");
+
   parser.process(QCoreApplication::arguments());
+
+  restore_ = parser.isSet(restore_option);
+  files_ = parser.positionalArguments();
+  json_ = parser.isSet(json_option);
+  targets_ = parser.values(target_option);
+
+  bool ok = false;
+  parallel_ = parser.value(parallel_option).toInt(&ok);
+  if (!ok || parallel_ < 1) {
+    qLog(Error) << "Invalid value for --parallel:" << parser.value(parallel_option);
+    return false;
+  }
+
+  const QString order = parser.value(order_option).toLower();
+  if (order == "fifo") order_ = RestoreQueue::Order_FIFO;
+  else if (order == "smallest") order_ = RestoreQueue::Order_SmallestFirst;
+  else if (order == "deadline") order_ = RestoreQueue::Order_Deadline;
+  else {
+    qLog(Error) << "Invalid value for --order:" << parser.value(order_option);
+    return false;
+  }
+
+  QMap<QString, QString> priorities;
+  if (!ParseFileValues(parser.values(priority_option), "--priority", &priorities)) return false;
+  for (QMap<QString, QString>::const_iterator it = priorities.constBegin() ; it != priorities.constEnd() ; ++it) {
+    const int priority = it.value().toInt(&ok);
+    if (!ok) {
+      qLog(Error) << "Invalid priority for" << it.key() << ":" << it.value();
+      return false;
+    }
+    priorities_.insert(it.key(), priority);
+  }
+
+  QMap<QString, QString> deadlines;
+  if (!ParseFileValues(parser.values(deadline_option), "--deadline", &deadlines)) return false;
+  for (QMap<QString, QString>::const_iterator it = deadlines.constBegin() ; it != deadlines.constEnd() ; ++it) {
+    const QDateTime deadline = QDateTime::fromString(it.value(), Qt::ISODate);
+    if (!deadline.isValid()) {
+      qLog(Error) << "Invalid deadline for" << it.key() << ":" << it.value();
+      return false;
+    }
+    deadlines_.insert(it.key(), deadline);
+  }
+
+  if (restore_ && files_.isEmpty()) {
+    qLog(Error) << "No backup files to restore.";
+    return false;
+  }
+
+  if (!restore_ && (!files_.isEmpty() || parser.isSet(parallel_option) || json_ || !targets_.isEmpty() || parser.isSet(order_option) || !priorities_.isEmpty() || !deadlines_.isEmpty())) {
+    qLog(Error) << "Backup files, --parallel, --json, --target, --order, --priority and --deadline can only be used with --restore.";
+    return false;
+  }
+
+  return true;
+
+}
+
+bool CommandlineOptions::ParseFileValues(const QStringList &values, const QString &option, QMap<QString, QString> *file_values) {
+
+  // The files are looked up by filename like the backup files given to restore.
+  for (const QString &value : values) {
+    const int i = value.lastIndexOf('=');
+    if (i <= 0) {
+      qLog(Error) << "Invalid value for" << option << ":" << value;
+      return false;
+    }
+    file_values->insert(QFileInfo(value.left(i)).fileName(), value.mid(i + 1).trimmed());
+  }
+
   return true;
 
 }
@@ -63,12 +158,14 @@ void CommandlineOptions::Load(const QByteArray &serialized) {
 }
 
 QDataStream &operator<<(QDataStream &s, const CommandlineOptions &a) {
-  s << a.nothing_;
+  s << a.restore_ << a.files_ << a.parallel_ << a.json_ << a.targets_ << static_cast<int>(a.order_) << a.priorities_ << a.deadlines_;
   return s;
 }
 
 QDataStream &operator>>(QDataStream &s, CommandlineOptions &a) {
-  s >> a.nothing_;
+  int order = RestoreQueue::Order_FIFO;
+  s >> a.restore_ >> a.files_ >> a.parallel_ >> a.json_ >> a.targets_ >> order >> a.priorities_ >> a.deadlines_;
+  a.order_ = static_cast<RestoreQueue::Order>(order);
   return s;
 }
 
@@ -22,6 +22,12 @@
 
 #include <QDataStream>
 #include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QDateTime>
+
+#include "restorequeue.h"
 
 class CommandlineOptions {
   friend QDataStream &operator<<(QDataStream &s, const CommandlineOptions &a);
@@ -31,12 +37,32 @@ class CommandlineOptions {
   explicit CommandlineOptions();
 
   bool Parse();
-  bool is_empty() const { return true; }
+  bool is_empty() const { return !restore_; }
   QByteArray Serialize() const;
   void Load(const QByteArray &serialized);
 
+  bool restore() const { return restore_; }
+  QStringList files() const { return files_; }
+  int parallel() const { return parallel_; }
+  bool json() const { return json_; }
+  QStringList targets() const { return targets_; }
+  RestoreQueue::Order order() const { return order_; }
+  // Priority and deadline of single files, by filename.
+  int priority(const QString &filename) const { return priorities_.value(filename, 0); }
+  QDateTime deadline(const QString &filename) const { return deadlines_.value(filename); }
+
+ private:
+  static bool ParseFileValues(const QStringList &values, const QString &option, QMap<QString, QString> *file_values);
+
  private:
-  bool nothing_;
+  bool restore_;
+  QStringList files_;
+  int parallel_;
+  bool json_;
+  QStringList targets_;
+  RestoreQueue::Order order_;
+  QMap<QString, int> priorities_;
+  QMap<QString, QDateTime> deadlines_;
 
 };
 
@@ -0,0 +1,212 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <QtGlobal>
+#include <QObject>
+#include <QThread>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QString>
+
+#include "logging.h"
+#include "dbconnectionpool.h"
+
+const int DBConnectionPool::kDefaultMaxConnections = 16;
+const int DBConnectionPool::kDefaultIdleTimeout = 300;
+
+DBConnectionPool::DBConnectionPool() :
+  max_connections_(kDefaultMaxConnections),
+  idle_timeout_(kDefaultIdleTimeout),
+  next_id_(1) {}
+
+DBConnectionPool::~DBConnectionPool() = default;
+
+DBConnectionPool *DBConnectionPool::Instance() {
+
+  static DBConnectionPool pool;
+  return &pool;
+
+}
+
+void DBConnectionPool::SetLimits(const int max_connections, const int idle_timeout) {
+
+  QMutexLocker l(&mutex_);
+  max_connections_ = qMax(1, max_connections);
+  idle_timeout_ = qMax(0, idle_timeout);
+  released_.wakeAll();
+
+}
+
+int DBConnectionPool::IndexOf(const QString &connection_name) const {
+
+  for (int i = 0 ; i < connections_.count() ; ++i) {
+    if (connections_[i].connection_name == connection_name) return i;
+  }
+  return -1;
+
+}
+
+bool DBConnectionPool::IsOwned(const Connection &connection) const {
+
+  // Idle connections without a thread can be taken over by any thread.
+  return connection.thread == QThread::currentThread() || connection.thread == nullptr;
+
+}
+
+void DBConnectionPool::Remove(const int i) {
+
+  const QString connection_name = connections_[i].connection_name;
+  {
+    Connection connection = connections_.takeAt(i);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+    if (connection.thread == nullptr && connection.db.isValid()) {
+      connection.db.moveToThread(QThread::currentThread());
+    }
+#endif
+    if (connection.db.isOpen()) {
+      connection.db.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connection_name);
+  qLog(Debug) << "Removed pooled connection" << connection_name;
+
+}
+
+void DBConnectionPool::WatchThread(QThread *thread) {
+
+  if (threads_.contains(thread)) return;
+  threads_.insert(thread);
+
+  // QThread::finished is emitted from the finishing thread itself, which is the only thread that can close its connections.
+  QObject::connect(thread, &QThread::finished, [this, thread]() { ThreadFinished(thread); });
+
+}
+
+void DBConnectionPool::ThreadFinished(QThread *thread) {
+
+  QMutexLocker l(&mutex_);
+
+  threads_.remove(thread);
+  for (int i = connections_.count() - 1 ; i >= 0 ; --i) {
+    if (connections_[i].thread == thread) {
+      if (connections_[i].leased) qLog(Error) << "Thread finished with leased connection" << connections_[i].connection_name;
+      Remove(i);
+    }
+  }
+
+  released_.wakeAll();
+
+}
+
+void DBConnectionPool::CloseExpired() {
+
+  // Only the idle connections this thread can close are checked.
+  for (int i = connections_.count() - 1 ; i >= 0 ; --i) {
+    const Connection &connection = connections_[i];
+    if (!connection.leased && IsOwned(connection) && connection.idle_timer.hasExpired(static_cast<qint64>(idle_timeout_) * 1000)) {
+      Remove(i);
+    }
+  }
+
+}
+
+bool DBConnectionPool::Acquire(const QString &connection_string, const int max_connections, const int timeout_ms, QSqlDatabase *db, QString *connection_name) {
+
+  QMutexLocker l(&mutex_);
+
+  QDeadlineTimer deadline(timeout_ms);
+  forever {
+    CloseExpired();
+
+    for (Connection &connection : connections_) {
+      if (connection.leased || connection.connection_string != connection_string || !IsOwned(connection)) continue;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+      if (connection.thread == nullptr && !connection.db.moveToThread(QThread::currentThread())) continue;
+#endif
+      connection.thread = QThread::currentThread();
+      connection.leased = true;
+      WatchThread(connection.thread);
+      *db = connection.db;
+      *connection_name = connection.connection_name;
+      return true;
+    }
+
+    // The limit applies to each server separately so one busy server doesn't starve the others.
+    int count = 0;
+    for (const Connection &connection : connections_) {
+      if (connection.connection_string == connection_string) ++count;
+    }
+
+    if (count < (max_connections > 0 ? max_connections : max_connections_)) {
+      Connection connection;
+      connection.connection_name = QString("pool_%1").arg(next_id_++);
+      connection.connection_string = connection_string;
+      connection.thread = QThread::currentThread();
+      connection.leased = true;
+      connections_ << connection;
+      WatchThread(connection.thread);
+      *db = QSqlDatabase();
+      *connection_name = connection.connection_name;
+      return true;
+    }
+
+    if (!released_.wait(&mutex_, deadline)) {
+      return false;
+    }
+  }
+
+}
+
+void DBConnectionPool::Attach(const QString &connection_name, const QSqlDatabase &db) {
+
+  QMutexLocker l(&mutex_);
+  const int i = IndexOf(connection_name);
+  if (i != -1) connections_[i].db = db;
+
+}
+
+void DBConnectionPool::Release(const QString &connection_name, const bool discard) {
+
+  QMutexLocker l(&mutex_);
+
+  const int i = IndexOf(connection_name);
+  if (i == -1) return;
+
+  Connection &connection = connections_[i];
+  if (discard || !connection.db.isOpen()) {
+    Remove(i);
+  }
+  else {
+    connection.leased = false;
+    connection.idle_timer.start();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 8, 0)
+    // Detach the connection from this thread so a worker in another thread can take it over.
+    if (connection.db.moveToThread(nullptr)) {
+      connection.thread = nullptr;
+    }
+#endif
+  }
+
+  released_.wakeAll();
+
+}
@@ -0,0 +1,92 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef DBCONNECTIONPOOL_H
+#define DBCONNECTIONPOOL_H
+
+#include <boost/noncopyable.hpp>
+
+#include <QtGlobal>
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QString>
+
+class QThread;
+
+// Open SQL server connections shared by all DBConnector instances.
+// Connections are leased per job and returned afterwards, idle connections are closed after a timeout.
+// Each connection string has its own limit, so every target server gets a separate pool.
+// Before Qt 6.8 a QSqlDatabase can only be used by the thread that opened it, so idle connections are only handed out to that thread.
+// Connections still bound to a thread are closed by that thread when it finishes, e.g. when a thread pool thread expires.
+
+class DBConnectionPool : boost::noncopyable {
+
+ public:
+  explicit DBConnectionPool();
+  ~DBConnectionPool();
+
+  static DBConnectionPool *Instance();
+
+  static const int kDefaultMaxConnections;
+  static const int kDefaultIdleTimeout;
+
+  void SetLimits(const int max_connections, const int idle_timeout);
+
+  // Returns an idle connection for the connection string in db, or an invalid db and a reserved connection name for a new connection.
+  // max_connections limits the connections for this connection string, 0 uses the pool limit.
+  // Returns false if all connections are in use for longer than timeout_ms.
+  bool Acquire(const QString &connection_string, const int max_connections, const int timeout_ms, QSqlDatabase *db, QString *connection_name);
+  // Adds the connection opened for a reserved connection name.
+  void Attach(const QString &connection_name, const QSqlDatabase &db);
+  // Returns a leased connection, closing it if discard is set. The caller must not hold any copies of the QSqlDatabase.
+  void Release(const QString &connection_name, const bool discard);
+
+ private:
+  struct Connection {
+    QString connection_name;
+    QString connection_string;
+    QSqlDatabase db;
+    QThread *thread;
+    bool leased;
+    QElapsedTimer idle_timer;
+  };
+
+  int IndexOf(const QString &connection_name) const;
+  bool IsOwned(const Connection &connection) const;
+  void Remove(const int i);
+  void CloseExpired();
+  void WatchThread(QThread *thread);
+  void ThreadFinished(QThread *thread);
+
+ private:
+  QMutex mutex_;
+  QWaitCondition released_;
+  QList<Connection> connections_;
+  QSet<QThread*> threads_;
+  int max_connections_;
+  int idle_timeout_;
+  quint64 next_id_;
+
+};
+
+#endif  // DBCONNECTIONPOOL_H
@@ -30,8 +30,19 @@
 #include <QSettings>
 #include <QtDebug>
 
+#include "config.h"
+
+#ifdef HAVE_ODBC
+#  ifdef Q_OS_WIN
+#    include <windows.h>
+#  endif
+#  include <sql.h>
+#  include <sqlext.h>
+#endif
+
 #include "logging.h"
 #include "dbconnector.h"
+#include "dbconnectionpool.h"
 #include "settingsdialog.h"
 
 int DBConnector::sNextConnectionID = 1;
@@ -40,11 +51,9 @@ int DBConnector::sDefaultLoginTimeout = 5;
 
 DBConnector::DBConnector(QObject *parent) :
   QObject(parent),
-#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
-  mutex_(QMutex::Recursive),
-#endif
   trusted_connection_(false),
-  login_timeout_(sDefaultLoginTimeout) {
+  login_timeout_(sDefaultLoginTimeout),
+  max_connections_(0) {
 
   {
     QMutexLocker l(&sNextConnectionIDMutex);
@@ -59,22 +68,47 @@ DBConnector::~DBConnector() = default;
 
 void DBConnector::ReloadSettings() {
 
+  QMutexLocker l(&mutex_);
   QSettings s;
   s.beginGroup(SettingsDialog::kSettingsGroup);
   driver_ = s.value("driver").toString();
   odbc_driver_ = s.value("odbc_driver").toString();
-  server_ = s.value("server").toString();
+  server_ = server_override_.isEmpty() ? s.value("server").toString() : server_override_;
   trusted_connection_ = s.value("trusted_connection").toBool();
   username_ = s.value("username").toString();
   QByteArray password = s.value("password").toByteArray();
   if (password.isEmpty()) password_.clear();
   else password_ = QString::fromUtf8(QByteArray::fromBase64(password));
   login_timeout_ = s.value("login_timeout", sDefaultLoginTimeout).toInt();
+  const int pool_max_connections = s.value("pool_max_connections", DBConnectionPool::kDefaultMaxConnections).toInt();
+  const int pool_idle_timeout = s.value("pool_idle_timeout", DBConnectionPool::kDefaultIdleTimeout).toInt();
+  // Limits for single servers override pool_max_connections.
+  max_connections_ = ServerLimit(s.value("server_max_connections").toStringList(), server_);
   s.endGroup();
 
+  DBConnectionPool::Instance()->SetLimits(pool_max_connections, pool_idle_timeout);
+
+}
+
+void DBConnector::SetServer(const QString &server) {
+
+  {
+    QMutexLocker l(&mutex_);
+    server_override_ = server;
+  }
+  ReloadSettings();
+
+}
+
+QString DBConnector::server() {
+
+  QMutexLocker l(&mutex_);
+  return server_;
+
 }
 
 void DBConnector::ConnectAsync() {
+  QMutexLocker l(&mutex_);
   ConnectAsync(driver_, odbc_driver_, server_, trusted_connection_, username_, password_, login_timeout_);
 }
 
@@ -84,7 +118,170 @@ void DBConnector::ConnectAsync(const QString &driver, const QString &odbc_driver
 }
 
 DBConnectResult DBConnector::Connect() {
-  return Connect(driver_, odbc_driver_, server_, trusted_connection_, username_, password_, login_timeout_, false);
+
+  // Take a copy of the settings so the mutex isn't held during the login.
+  QMutexLocker l(&mutex_);
+  const QString driver = driver_;
+  const QString odbc_driver = odbc_driver_;
+  const QString server = server_;
+  const bool trusted_connection = trusted_connection_;
+  const QString username = username_;
+  const QString password = password_;
+  const int login_timeout = login_timeout_;
+  l.unlock();
+
+  return Connect(driver, odbc_driver, server, trusted_connection, username, password, login_timeout, false);
+
+}
+
+QString DBConnector::ConnectionString(const QString &odbc_driver, const QString &server, const bool trusted_connection, const QString &username, const QString &password) {
+
+  QString connection_string = QString("Driver={%1};").arg(odbc_driver);
+  connection_string.append("Server=");
+  connection_string.append(server);
+  connection_string.append(";");
+  if (trusted_connection) {
+    connection_string.append("Trusted_Connection=Yes;");
+  }
+  else {
+    connection_string.append("Uid=");
+    connection_string.append(username);
+    connection_string.append(";");
+    connection_string.append("Pwd=");
+    connection_string.append(password);
+    connection_string.append(";");
+  }
+  connection_string.append("Encrypt=no;");
+  return connection_string;
+
+}
+
+QString DBConnector::ConnectOptions(const int login_timeout) {
+
+  // ODBC 3 enables the block cursor used for forward only queries.
+  QString connect_options("SQL_ATTR_ODBC_VERSION=SQL_OV_ODBC3;");
+  if (login_timeout > 0) {
+    connect_options.append(QString("SQL_ATTR_LOGIN_TIMEOUT=%1;").arg(login_timeout));
+  }
+  return connect_options;
+
+}
+
+bool DBConnector::IsAlive(const QSqlDatabase &db) {
+
+  if (!db.isOpen()) return false;
+
+#ifdef HAVE_ODBC
+  // SQL_ATTR_CONNECTION_DEAD reports the state the driver last saw without a round trip to the server.
+  const QVariant handle = db.driver()->handle();
+  if (handle.isValid() && qstrcmp(handle.typeName(), "SQLHANDLE") == 0) {
+    SQLHANDLE hdbc = *static_cast<const SQLHANDLE*>(handle.constData());
+    if (hdbc) {
+      SQLUINTEGER dead = SQL_CD_FALSE;
+      const SQLRETURN r = SQLGetConnectAttr(hdbc, SQL_ATTR_CONNECTION_DEAD, &dead, 0, nullptr);
+      if (SQL_SUCCEEDED(r)) return dead != SQL_CD_TRUE;
+    }
+  }
+#endif
+
+  return true;
+
+}
+
+int DBConnector::ServerLimit(const QStringList &limits, const QString &server) {
+
+  for (const QString &limit : limits) {
+    const int i = limit.lastIndexOf('=');
+    if (i > 0 && limit.left(i).trimmed().compare(server, Qt::CaseInsensitive) == 0) {
+      return limit.mid(i + 1).trimmed().toInt();
+    }
+  }
+
+  return 0;
+
+}
+
+DBConnectResult DBConnector::Lease() {
+
+  QMutexLocker l(&mutex_);
+  const QString driver = driver_;
+  const QString odbc_driver = odbc_driver_;
+  const QString server = server_;
+  const bool trusted_connection = trusted_connection_;
+  const QString username = username_;
+  const QString password = password_;
+  const int login_timeout = login_timeout_;
+  const int max_connections = max_connections_;
+  l.unlock();
+
+  if (driver.isEmpty() || odbc_driver.isEmpty() || server.isEmpty() || (!trusted_connection && username.isEmpty()) || (!trusted_connection && password.isEmpty())) {
+    const QString error = tr("Missing SQL server settings");
+    qLog(Error) << error;
+    emit ConnectionFailure(error);
+    return DBConnectResult(false, QSqlDatabase(), error);
+  }
+
+  const QString connection_string = ConnectionString(odbc_driver, server, trusted_connection, username, password);
+  DBConnectionPool *pool = DBConnectionPool::Instance();
+
+  forever {
+    QSqlDatabase db;
+    QString connection_name;
+    if (!pool->Acquire(driver + ";" + connection_string, max_connections, qMax(login_timeout, 1) * 1000, &db, &connection_name)) {
+      const QString error = tr("All SQL server connections are in use.");
+      qLog(Error) << error;
+      emit ConnectionFailure(error);
+      return DBConnectResult(false, QSqlDatabase(), error);
+    }
+
+    // Reuse the idle connection unless the driver has seen it drop.
+    if (db.isValid()) {
+      if (IsAlive(db)) {
+        emit ConnectionSuccess(odbc_driver, server);
+        return DBConnectResult(true, db);
+      }
+      qLog(Debug) << "Pooled connection" << connection_name << "is dead, reconnecting.";
+      db = QSqlDatabase();
+      pool->Release(connection_name, true);
+      continue;
+    }
+
+    qLog(Debug) << "Opening pooled connection" << connection_name << "in thread" << QThread::currentThread();
+
+    db = QSqlDatabase::addDatabase(driver, connection_name);
+    db.setDatabaseName(connection_string);
+    db.setConnectOptions(ConnectOptions(login_timeout));
+
+    emit Connecting(odbc_driver, server);
+
+    if (!db.open()) {
+      const QString error = db.lastError().text();
+      qLog(Error) << error;
+      db = QSqlDatabase();
+      pool->Release(connection_name, true);
+      emit ConnectionFailure(error);
+      return DBConnectResult(false, QSqlDatabase(), error);
+    }
+
+    pool->Attach(connection_name, db);
+
+    qLog(Info) << "Connected to" << server;
+    emit ConnectionSuccess(odbc_driver, server);
+
+    return DBConnectResult(true, db);
+  }
+
+}
+
+void DBConnector::Return(QSqlDatabase &db) {
+
+  if (!db.isValid()) return;
+
+  const QString connection_name = db.connectionName();
+  const bool discard = !IsAlive(db);
+  db = QSqlDatabase();
+  DBConnectionPool::Instance()->Release(connection_name, discard);
+
 }
 
 DBConnectResult DBConnector::Connect(const QString &driver, const QString &odbc_driver, const QString &server, const bool trusted_connection, const QString &username, const QString &password, const int login_timeout, const bool test) {
@@ -102,7 +299,7 @@ DBConnectResult DBConnector::Connect(const QString &driver, const QString &odbc_
     return DBConnectResult(false, QSqlDatabase(), error);
   }
 
-  QMutexLocker l(&connect_mutex_);
+  // Each thread has its own named connection, so logins from different threads run in parallel without locking.
   const QString connection_id = QString("%1_thread_%2").arg(connection_id_).arg(reinterpret_cast<quint64>(QThread::currentThread()));
   QSqlDatabase db;
   if (QSqlDatabase::connectionNames().contains(connection_id)) {
@@ -112,22 +309,7 @@ DBConnectResult DBConnector::Connect(const QString &driver, const QString &odbc_
     db = QSqlDatabase::addDatabase(driver, connection_id);
   }
 
-  QString connection_string = QString("Driver={%1};").arg(odbc_driver);
-  connection_string.append("Server=");
-  connection_string.append(server);
-  connection_string.append(";");
-  if (trusted_connection) {
-    connection_string.append("Trusted_Connection=Yes;");
-  }
-  else {
-    connection_string.append("Uid=");
-    connection_string.append(username);
-    connection_string.append(";");
-    connection_string.append("Pwd=");
-    connection_string.append(password);
-    connection_string.append(";");
-  }
-  connection_string.append("Encrypt=no;");
+  const QString connection_string = ConnectionString(odbc_driver, server, trusted_connection, username, password);
 
   if (db.isOpen()) {
     if (db.databaseName() == connection_string) {
@@ -142,10 +324,7 @@ DBConnectResult DBConnector::Connect(const QString &driver, const QString &odbc_
   qLog(Debug) << "Connecting using connection id" << connection_id << "connection string" << connection_string << "in thread" << QThread::currentThread();
 
   db.setDatabaseName(connection_string);
-
-  if (login_timeout > 0) {
-    db.setConnectOptions(QString("SQL_ATTR_LOGIN_TIMEOUT=%1;").arg(login_timeout));
-  }
+  db.setConnectOptions(ConnectOptions(login_timeout));
 
   emit Connecting(odbc_driver, server);
   emit Connecting(odbc_driver, server);
@@ -181,8 +360,6 @@ void DBConnector::CloseAsync() {
 
 void DBConnector::Close() {
 
-  QMutexLocker l(&connect_mutex_);
-
   const QString connection_id = QString("%1_thread_%2").arg(connection_id_).arg(reinterpret_cast<quint64>(QThread::currentThread()));
 
   // Try to find an existing connection for this thread
@@ -22,11 +22,9 @@
 
 #include <QObject>
 #include <QMutex>
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-#  include <QRecursiveMutex>
-#endif
 #include <QSqlDatabase>
 #include <QString>
+#include <QStringList>
 
 class DBConnectResult;
 
@@ -40,11 +38,10 @@ class DBConnector : public QObject {
   static int sDefaultLoginTimeout;
 
   void ReloadSettings();
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-  QRecursiveMutex *Mutex() { return &mutex_; }
-#else
-  QMutex *Mutex() { return &mutex_; }
-#endif
+  // Uses the given server instead of the one from the settings, an empty server reverts to the settings.
+  void SetServer(const QString &server);
+  QString server();
+
   void ConnectAsync();
   void ConnectAsync(const QString &driver, const QString &odbc_driver, const QString &server, const bool trusted_connection, const QString &username, const QString &password, const int login_timeout = 0, const bool test = false);
   void CloseAsync();
@@ -61,24 +58,34 @@ class DBConnector : public QObject {
 
   void Close();
 
+ public:
+  // Leases a connection from the shared pool, must be given back with Return() in the same thread.
+  DBConnectResult Lease();
+  void Return(QSqlDatabase &db);
+
+  static bool IsAlive(const QSqlDatabase &db);
+  // Looks up the limit for a server in a list of "server=limit" entries, returns 0 if there is none.
+  static int ServerLimit(const QStringList &limits, const QString &server);
+
+ private:
+  static QString ConnectionString(const QString &odbc_driver, const QString &server, const bool trusted_connection, const QString &username, const QString &password);
+  static QString ConnectOptions(const int login_timeout);
+
  private:
   static QMutex sNextConnectionIDMutex;
   static int sNextConnectionID;
 
-  QMutex connect_mutex_;
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-  QRecursiveMutex mutex_;
-#else
   QMutex mutex_;
-#endif
   int connection_id_;
   QString driver_;
   QString odbc_driver_;
   QString server_;
+  QString server_override_;
   bool trusted_connection_;
   QString username_;
   QString password_;
   int login_timeout_;
+  int max_connections_;
 
 };
 
@@ -0,0 +1,321 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstdio>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QThread>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QFileInfo>
+#include <QSettings>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "logging.h"
+#include "headlessrestore.h"
+#include "application.h"
+#include "commandlineoptions.h"
+#include "bakfilebackend.h"
+#include "backupbackend.h"
+#include "bakfileitem.h"
+#include "backupresult.h"
+#include "settingsdialog.h"
+#include "dbconnector.h"
+
+HeadlessRestore::HeadlessRestore(Application *app, const CommandlineOptions &options, QObject *parent)
+    : QObject(parent),
+      app_(app),
+      options_(options),
+      scan_finished_(false),
+      jobs_total_(0),
+      jobs_failed_(0) {
+
+  targets_ = Targets();
+  for (const QString &server : targets_) {
+    AddWorkers(server, MaxJobs(server));
+  }
+
+  for (BackupBackend *backend : backends_) {
+    connect(backend, &BackupBackend::RestoreStatusCurrent, this, &HeadlessRestore::RestoreStatusCurrent);
+    connect(backend, &BackupBackend::RestoreProgressCurrentValue, this, &HeadlessRestore::RestoreProgressCurrentValue);
+    connect(backend, &BackupBackend::RestoreFinished, this, &HeadlessRestore::RestoreFinished);
+    connect(backend, &BackupBackend::RestoreComplete, this, &HeadlessRestore::RestoreComplete);
+  }
+
+  connect(app_->bakfile_backend(), &BakFileBackend::AddedFiles, this, &HeadlessRestore::AddedFiles);
+  connect(app_->bakfile_backend(), &BakFileBackend::DeletedFiles, this, &HeadlessRestore::DeletedFiles);
+  connect(app_->bakfile_backend(), &BakFileBackend::ScanFinished, this, &HeadlessRestore::ScanFinished);
+  connect(app_->bakfile_backend(), &BakFileBackend::LoadError, this, &HeadlessRestore::LoadError);
+
+}
+
+HeadlessRestore::~HeadlessRestore() = default;
+
+QStringList HeadlessRestore::Targets() const {
+
+  // Without --target everything is restored to the server from the settings.
+  if (options_.targets().isEmpty()) return QStringList() << QString();
+
+  QSettings s;
+  s.beginGroup(SettingsDialog::kSettingsGroup);
+  const QString server = s.value("server").toString();
+  const QStringList servers = s.value("servers").toStringList();
+  s.endGroup();
+
+  QStringList targets;
+  for (const QString &target : options_.targets()) {
+    if (target.compare("all", Qt::CaseInsensitive) == 0) {
+      if (!server.isEmpty()) targets << server;
+      targets << servers;
+    }
+    else {
+      targets << target;
+    }
+  }
+  targets.removeDuplicates();
+  targets.removeAll(QString());
+
+  return targets;
+
+}
+
+int HeadlessRestore::MaxJobs(const QString &server) const {
+
+  QSettings s;
+  s.beginGroup(SettingsDialog::kSettingsGroup);
+  const QString server_name = server.isEmpty() ? s.value("server").toString() : server;
+  int max_jobs = s.value("server_max_jobs", 0).toInt();
+  // Limits for single servers override server_max_jobs.
+  const int server_limit = DBConnector::ServerLimit(s.value("server_limits").toStringList(), server_name);
+  if (server_limit > 0) max_jobs = server_limit;
+  s.endGroup();
+
+  return max_jobs > 0 ? qMin(options_.parallel(), max_jobs) : options_.parallel();
+
+}
+
+void HeadlessRestore::AddWorkers(const QString &server, const int count) {
+
+  for (int i = 0 ; i < count ; ++i) {
+    BackupBackend *backend = nullptr;
+    if (backends_.isEmpty()) {
+      backend = app_->backup_backend();
+    }
+    else {
+      backend = new BackupBackend();
+      app_->MoveToNewThread(backend, QThread::LowPriority);
+    }
+    // The backends live in their own threads.
+    QMetaObject::invokeMethod(backend, "SetServer", Qt::QueuedConnection, Q_ARG(QString, server));
+    backends_ << backend;
+    servers_.insert(backend, server);
+  }
+
+}
+
+QString HeadlessRestore::JobName(BackupBackend *backend) const {
+
+  if (targets_.count() <= 1) return running_.value(backend);
+  return QString("%1 (%2)").arg(running_.value(backend), servers_.value(backend));
+
+}
+
+void HeadlessRestore::Start() {
+
+  for (BackupBackend *backend : backends_) {
+    QMetaObject::invokeMethod(backend, "ReloadSettings", Qt::QueuedConnection);
+  }
+
+  // The restores are started after the first scan of the local backup path.
+  app_->bakfile_backend()->ReloadSettingsAsync();
+
+}
+
+void HeadlessRestore::AddedFiles(BakFileItemList files) {
+
+  for (BakFileItemPtr fileitem : files) {
+    files_.insert(fileitem->filename(), fileitem);
+  }
+
+}
+
+void HeadlessRestore::DeletedFiles(BakFileItemList files) {
+
+  for (BakFileItemPtr fileitem : files) {
+    files_.remove(fileitem->filename());
+  }
+
+}
+
+void HeadlessRestore::LoadError(const QString &error) {
+
+  if (scan_finished_) return;
+
+  QJsonObject json;
+  json["event"] = "error";
+  json["message"] = error;
+  Print(json, error);
+
+}
+
+void HeadlessRestore::ScanFinished() {
+
+  if (scan_finished_) return;
+  scan_finished_ = true;
+
+  if (targets_.isEmpty()) {
+    QJsonObject json;
+    json["event"] = "error";
+    json["message"] = "No target servers.";
+    Print(json, tr("No target servers."));
+    Finish(ExitCode_Error);
+    return;
+  }
+
+  // Files with a higher priority run first, the order sorts the files with the same priority.
+  for (const QString &server : targets_) {
+    queues_[server].set_order(options_.order());
+  }
+
+  bool missing = false;
+  for (const QString &file : options_.files()) {
+    const QString filename = QFileInfo(file).fileName();
+    if (!files_.contains(filename)) {
+      missing = true;
+      QJsonObject json;
+      json["event"] = "error";
+      json["file"] = filename;
+      json["message"] = "Backup file not found in the local backup path.";
+      Print(json, tr("%1: Backup file not found in the local backup path.").arg(filename));
+      continue;
+    }
+    for (const QString &server : targets_) {
+      queues_[server].Enqueue(files_[filename], options_.priority(filename), options_.deadline(filename));
+      ++jobs_total_;
+    }
+  }
+
+  if (missing) {
+    Finish(ExitCode_Error);
+    return;
+  }
+
+  StartRestores();
+
+}
+
+void HeadlessRestore::StartRestores() {
+
+  for (BackupBackend *backend : backends_) {
+    if (running_.contains(backend)) continue;
+    RestoreQueue &queue = queues_[servers_[backend]];
+    if (queue.isEmpty()) continue;
+    BakFileItemPtr fileitem = queue.Dequeue();
+    running_.insert(backend, fileitem->filename());
+    progress_.insert(backend, -1);
+    QMetaObject::invokeMethod(backend, "QueueRestores", Qt::QueuedConnection, Q_ARG(BakFileItemList, BakFileItemList() << fileitem));
+  }
+
+  if (running_.isEmpty()) {
+    QJsonObject json;
+    json["event"] = "complete";
+    json["total"] = jobs_total_;
+    json["failed"] = jobs_failed_;
+    Print(json, tr("%1 of %2 backups restored.").arg(jobs_total_ - jobs_failed_).arg(jobs_total_));
+    Finish(jobs_failed_ == 0 ? ExitCode_Success : ExitCode_RestoreFailed);
+  }
+
+}
+
+void HeadlessRestore::RestoreStatusCurrent(const QString &message) {
+
+  BackupBackend *backend = qobject_cast<BackupBackend*>(sender());
+  if (!backend || !running_.contains(backend)) return;
+
+  if (options_.json()) {
+    QJsonObject json;
+    json["event"] = "status";
+    json["file"] = running_[backend];
+    if (!servers_[backend].isEmpty()) json["server"] = servers_[backend];
+    json["message"] = message;
+    Print(json, QString());
+  }
+
+}
+
+void HeadlessRestore::RestoreProgressCurrentValue(const int value) {
+
+  BackupBackend *backend = qobject_cast<BackupBackend*>(sender());
+  if (!backend || !running_.contains(backend) || progress_[backend] == value) return;
+  progress_[backend] = value;
+
+  QJsonObject json;
+  json["event"] = "progress";
+  json["file"] = running_[backend];
+  if (!servers_[backend].isEmpty()) json["server"] = servers_[backend];
+  json["value"] = value;
+  Print(json, QString("%1: %2%").arg(JobName(backend)).arg(value));
+
+}
+
+void HeadlessRestore::RestoreFinished(const BackupResult &result) {
+
+  if (!result.success()) ++jobs_failed_;
+
+  QJsonObject json = result.ToJson();
+  json["event"] = "finished";
+  const QString name = targets_.count() <= 1 ? result.filename() : QString("%1 (%2)").arg(result.filename(), result.server());
+  Print(json, result.success() ? tr("%1: Restored successfully (%2).").arg(name, result.Summary()) : tr("%1: Restore failed: %2").arg(name, result.errors().join(" ")));
+
+}
+
+void HeadlessRestore::RestoreComplete() {
+
+  BackupBackend *backend = qobject_cast<BackupBackend*>(sender());
+  if (!backend) return;
+
+  running_.remove(backend);
+  progress_.remove(backend);
+  StartRestores();
+
+}
+
+void HeadlessRestore::Finish(const ExitCode exit_code) {
+
+  QCoreApplication::exit(exit_code);
+
+}
+
+void HeadlessRestore::Print(const QJsonObject &json, const QString &text) {
+
+  if (options_.json()) {
+    fprintf(stdout, "%s\n", QJsonDocument(json).toJson(QJsonDocument::Compact).constData());
+  }
+  else if (!text.isEmpty()) {
+    fprintf(stdout, "%s\n", text.toLocal8Bit().constData());
+  }
+  fflush(stdout);
+
+}
@@ -0,0 +1,91 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef HEADLESSRESTORE_H
+#define HEADLESSRESTORE_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+#include "commandlineoptions.h"
+#include "bakfileitem.h"
+#include "backupresult.h"
+#include "restorequeue.h"
+
+class Application;
+class BackupBackend;
+
+// Restores the backup files given on the commandline without a GUI.
+// Each target server gets its own workers and queue, a backup given with several targets is restored to all of them.
+
+class HeadlessRestore : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit HeadlessRestore(Application *app, const CommandlineOptions &options, QObject *parent = nullptr);
+  ~HeadlessRestore();
+
+  enum ExitCode {
+    ExitCode_Success = 0,
+    ExitCode_Error = 1,
+    ExitCode_RestoreFailed = 2
+  };
+
+  void Start();
+
+ private:
+  QStringList Targets() const;
+  int MaxJobs(const QString &server) const;
+  void AddWorkers(const QString &server, const int count);
+  QString JobName(BackupBackend *backend) const;
+  void StartRestores();
+  void Finish(const ExitCode exit_code);
+  void Print(const QJsonObject &json, const QString &text);
+
+ private slots:
+  void AddedFiles(BakFileItemList files);
+  void DeletedFiles(BakFileItemList files);
+  void ScanFinished();
+  void LoadError(const QString &error);
+  void RestoreStatusCurrent(const QString &message);
+  void RestoreProgressCurrentValue(const int value);
+  void RestoreFinished(const BackupResult &result);
+  void RestoreComplete();
+
+ private:
+  Application *app_;
+  CommandlineOptions options_;
+  QStringList targets_;
+  QList<BackupBackend*> backends_;
+  QMap<BackupBackend*, QString> servers_;
+  QMap<BackupBackend*, QString> running_;
+  QMap<BackupBackend*, int> progress_;
+  QMap<QString, BakFileItemPtr> files_;
+  QMap<QString, RestoreQueue> queues_;
+  bool scan_finished_;
+  int jobs_total_;
+  int jobs_failed_;
+
+};
+
+#endif  // HEADLESSRESTORE_H
@@ -53,6 +53,7 @@ namespace logging {
 static Level sDefaultLevel = Level_Debug;
 static QMap<QString, Level> *sClassLevels = nullptr;
 static QIODevice *sNullDevice = nullptr;
+static bool sOutputStderr = false;
 
 const char *kDefaultLogLevels = "*:3";
 
@@ -124,9 +125,11 @@ class LoggedDebug : public DebugBase<LoggedDebug> {
 
 static void MessageHandler(QtMsgType type, const QMessageLogContext&, const QString &message) {
 
+  FILE *output = sOutputStderr || type == QtCriticalMsg || type == QtFatalMsg ? stderr : stdout;
+
   if (message.startsWith(kMessageHandlerMagic)) {
-    fprintf(type == QtCriticalMsg || type == QtFatalMsg ? stderr : stdout, "%s\n", message.toUtf8().data() + kMessageHandlerMagicLength);
-    fflush(type == QtCriticalMsg || type == QtFatalMsg ? stderr : stdout);
+    fprintf(output, "%s\n", message.toUtf8().data() + kMessageHandlerMagicLength);
+    fflush(output);
     return;
   }
 
@@ -151,8 +154,8 @@ static void MessageHandler(QtMsgType type, const QMessageLogContext&, const QStr
     d << line.toLocal8Bit().constData();
     if (d.buf_) {
       d.buf_->close();
-      fprintf(type == QtCriticalMsg || type == QtFatalMsg ? stderr : stdout, "%s\n", d.buf_->buffer().data());
-      fflush(type == QtCriticalMsg || type == QtFatalMsg ? stderr : stdout);
+      fprintf(output, "%s\n", d.buf_->buffer().data());
+      fflush(output);
     }
   }
 
@@ -211,6 +214,10 @@ void SetLevels(const QString &levels) {
 
 }
 
+void SetOutputStderr(const bool output_stderr) {
+  sOutputStderr = output_stderr;
+}
+
 static QString ParsePrettyFunction(const char *pretty_function) {
 
   // Get the class name out of the function name.
@@ -69,6 +69,7 @@ enum Level {
 
   void Init();
   void SetLevels(const QString &levels);
+  void SetOutputStderr(const bool output_stderr);
 
   void DumpStackTrace();
 
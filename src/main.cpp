@@ -47,6 +47,7 @@
 #include "utilities.h"
 #include "metatypes.h"
 #include "mainwindow.h"
+#include "headlessrestore.h"
 
 #if defined(Q_OS_UNIX) && !defined(Q_OS_MACOS) && defined(HAVE_QSQLODBCX)
 #  include <QtPlugin>
@@ -87,12 +88,27 @@ int main(int argc, char* argv[]) {
     if (!options.Parse()) return 1;
   }
 
+  // Keep stdout for the progress and results when restoring without the GUI.
+  if (options.restore()) {
+    logging::SetOutputStderr(true);
+  }
+
   qLog(Info) << "SQLRestore" << SQLRESTORE_VERSION_DISPLAY;
 
   // Seed the random number generators.
   Utilities::Seed();
   assert(Utilities::GetRandomStringWithCharsAndNumbers(20) != Utilities::GetRandomStringWithCharsAndNumbers(20));
 
+  if (options.restore()) {
+    QCoreApplication a(argc, argv);
+    Q_INIT_RESOURCE(data);
+    SQLRestore_Metatypes::RegisterMetaTypes();
+    Application app;
+    HeadlessRestore headless(&app, options);
+    headless.Start();
+    return a.exec();
+  }
+
   QApplication a(argc, argv);
 
 #ifdef Q_OS_UNIX
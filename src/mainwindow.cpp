@@ -264,7 +264,7 @@ void MainWindow::Reset() {
   ui_->button_back->hide();
   ui_->button_select_all->show();
   ui_->button_unselect_all->show();
-  ui_->button_select_all->setEnabled(bak_file_model_->rowCount() > ui_->file_view_container->view()->selectionModel()->selectedRows().count());
+  ui_->button_select_all->setEnabled(bak_file_model_->item_count() > ui_->file_view_container->view()->selectionModel()->selectedRows().count());
   ui_->button_unselect_all->setEnabled(!ui_->file_view_container->view()->selectionModel()->selectedRows().isEmpty());
   if (file_load_error_.isEmpty()) {
     statusbar_label_->setText(connection_status_);
@@ -332,7 +332,7 @@ void MainWindow::FileLoadProgress(const int value) {
     if (ui_->stackedWidget->currentWidget() == ui_->select_file) {
       ui_->button_restore->show();
       ui_->button_restore->setEnabled(connected_ && !ui_->file_view_container->view()->selectionModel()->selectedRows().isEmpty());
-      ui_->button_select_all->setEnabled(ui_->file_view_container->view()->selectionModel()->selectedRows().count() < bakfile_sort_model_->rowCount());
+      ui_->button_select_all->setEnabled(ui_->file_view_container->view()->selectionModel()->selectedRows().count() < bakfile_sort_model_->rowCount() || bakfile_sort_model_->canFetchMore(QModelIndex()));
       ui_->button_unselect_all->setEnabled(!ui_->file_view_container->view()->selectionModel()->selectedRows().isEmpty());
     }
   }
@@ -364,7 +364,7 @@ void MainWindow::FileSelectionChanged(const QItemSelection&, const QItemSelectio
 
   if (ui_->stackedWidget->currentWidget() == ui_->select_file) {
     ui_->button_restore->setEnabled(connected_ && !ui_->file_view_container->view()->selectionModel()->selectedRows().isEmpty());
-    ui_->button_select_all->setEnabled(ui_->file_view_container->view()->selectionModel()->selectedRows().count() < bakfile_sort_model_->rowCount());
+    ui_->button_select_all->setEnabled(ui_->file_view_container->view()->selectionModel()->selectedRows().count() < bakfile_sort_model_->rowCount() || bakfile_sort_model_->canFetchMore(QModelIndex()));
     ui_->button_unselect_all->setEnabled(!ui_->file_view_container->view()->selectionModel()->selectedRows().isEmpty());
   }
 
@@ -477,8 +477,8 @@ void MainWindow::RestoreFailure(const QStringList &errors) {
   Q_UNUSED(errors);
 }
 
-void MainWindow::RestoreFinished(const QString &filename, const bool success, const QStringList &errors) {
-  jobs_finished_ << BackupResult(filename, success, errors);
+void MainWindow::RestoreFinished(const BackupResult &result) {
+  jobs_finished_ << result;
 }
 
 void MainWindow::RestoreComplete() {
@@ -486,7 +486,7 @@ void MainWindow::RestoreComplete() {
   int failed = 0;
   for (BackupResult result : qAsConst(jobs_finished_)) {
     if (result.success()) {
-      ui_->textBrowser->append(tr("Restore of %1 was successful.").arg(result.filename()));
+      ui_->textBrowser->append(tr("Restore of %1 was successful (%2).").arg(result.filename(), result.Summary()));
     }
     else {
       ui_->textBrowser->append(tr("Restore of %1 failed.").arg(result.filename()));
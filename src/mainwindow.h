@@ -86,7 +86,7 @@ class MainWindow : public QMainWindow {
 
   void RestoreSuccess();
   void RestoreFailure(const QStringList&);
-  void RestoreFinished(const QString &filename, const bool success, const QStringList &errors);
+  void RestoreFinished(const BackupResult &result);
   void RestoreComplete();
 
  signals:
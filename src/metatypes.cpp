@@ -24,6 +24,7 @@
 #include "metatypes.h"
 #include "scopedresult.h"
 #include "bakfileitem.h"
+#include "backupresult.h"
 
 namespace SQLRestore_Metatypes {
 
@@ -34,6 +35,7 @@ void RegisterMetaTypes() {
   qRegisterMetaType<QList<BakFileItem>>("QList<BakFileItem>");
   qRegisterMetaType<BakFileItemPtr>("BakFileItemPtr");
   qRegisterMetaType<ScopedResult*>("ScopedResult*");
+  qRegisterMetaType<BackupResult>("BackupResult");
 }
 
 }  // namespace SQLRestore_Metatypes
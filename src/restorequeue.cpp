@@ -0,0 +1,87 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QList>
+#include <QDateTime>
+
+#include "restorequeue.h"
+#include "bakfileitem.h"
+
+RestoreQueue::RestoreQueue() : order_(Order_FIFO), next_sequence_(0) {}
+
+void RestoreQueue::set_order(const Order order) {
+
+  if (order == order_) return;
+  order_ = order;
+  std::stable_sort(jobs_.begin(), jobs_.end(), [this](const Job &a, const Job &b) { return RunsBefore(a, b); });
+
+}
+
+bool RestoreQueue::RunsBefore(const Job &a, const Job &b) const {
+
+  if (a.priority != b.priority) return a.priority > b.priority;
+
+  switch (order_) {
+    case Order_SmallestFirst:
+      if (a.fileitem->file_size() != b.fileitem->file_size()) return a.fileitem->file_size() < b.fileitem->file_size();
+      break;
+    case Order_Deadline:
+      // Jobs without a deadline run after the jobs with one.
+      if (a.deadline.isValid() != b.deadline.isValid()) return a.deadline.isValid();
+      if (a.deadline.isValid() && a.deadline != b.deadline) return a.deadline < b.deadline;
+      break;
+    case Order_FIFO:
+      break;
+  }
+
+  return a.sequence < b.sequence;
+
+}
+
+void RestoreQueue::Insert(const Job &job) {
+
+  QList<Job>::iterator it = std::upper_bound(jobs_.begin(), jobs_.end(), job, [this](const Job &a, const Job &b) { return RunsBefore(a, b); });
+  jobs_.insert(it, job);
+
+}
+
+void RestoreQueue::Enqueue(BakFileItemPtr fileitem, const int priority, const QDateTime &deadline) {
+
+  Job job;
+  job.fileitem = fileitem;
+  job.priority = priority;
+  job.deadline = deadline;
+  job.sequence = next_sequence_++;
+  Insert(job);
+
+}
+
+BakFileItemPtr RestoreQueue::Dequeue() {
+
+  if (jobs_.isEmpty()) return BakFileItemPtr();
+  return jobs_.takeFirst().fileitem;
+
+}
+
+void RestoreQueue::Clear() {
+  jobs_.clear();
+}
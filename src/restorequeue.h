@@ -0,0 +1,70 @@
+/*
+   This file is part of SQL Restore
+   Copyright 2019, Jonas Kvinge <jonas@jkvinge.net>
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef RESTOREQUEUE_H
+#define RESTOREQUEUE_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QDateTime>
+
+#include "bakfileitem.h"
+
+// Restore jobs ordered by priority, and within the same priority by the queue order.
+
+class RestoreQueue {
+
+ public:
+  explicit RestoreQueue();
+
+  enum Order {
+    Order_FIFO,
+    Order_SmallestFirst,
+    Order_Deadline
+  };
+
+  Order order() const { return order_; }
+  void set_order(const Order order);
+
+  bool isEmpty() const { return jobs_.isEmpty(); }
+  int count() const { return jobs_.count(); }
+
+  void Enqueue(BakFileItemPtr fileitem, const int priority = 0, const QDateTime &deadline = QDateTime());
+  BakFileItemPtr Dequeue();
+  void Clear();
+
+ private:
+  struct Job {
+    BakFileItemPtr fileitem;
+    int priority;
+    QDateTime deadline;
+    quint64 sequence;
+  };
+
+  bool RunsBefore(const Job &a, const Job &b) const;
+  void Insert(const Job &job);
+
+ private:
+  QList<Job> jobs_;
+  Order order_;
+  quint64 next_sequence_;
+
+};
+
+#endif  // RESTOREQUEUE_H
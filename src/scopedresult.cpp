@@ -19,42 +19,85 @@
 
 #include <QString>
 #include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
+#include <QJsonDocument>
+#include <QSqlDriver>
 #include <QtDebug>
 
 #include "logging.h"
 #include "scopedresult.h"
 
-ScopedResult::ScopedResult(QObject *parent) : QObject(parent), pending_(true), success_(false) {}
+ScopedResult::ScopedResult(QObject *parent) : QObject(parent), pending_(true) {
+  timer_.start();
+}
 
-ScopedResult::ScopedResult(const QString &filename, QObject *parent) : QObject(parent), filename_(filename), pending_(true), success_(false) {}
+ScopedResult::ScopedResult(const QString &filename, QObject *parent) : QObject(parent), result_(filename, false, QStringList()), pending_(true) {
+  timer_.start();
+}
 
 ScopedResult::~ScopedResult() {
 
   if (pending_)
-    qLog(Error) << filename_ << "Still pending!";
+    qLog(Error) << result_.filename() << "Still pending!";
+
+  result_.set_total_msec(timer_.elapsed());
 
-  if (success_) {
+  FinishDriverStatistics();
+
+  if (result_.success()) {
     qLog(Debug) << "Success";
     emit Status(tr("Success"));
     emit Success();
   }
   else {
     qLog(Error) << "Failure";
-    emit Failure(errors_);
+    emit Failure(result_.errors());
+  }
+
+  qLog(Info) << QJsonDocument(result_.ToJson()).toJson(QJsonDocument::Compact).constData();
+
+  emit Finished1(result_.success());
+  emit Finished2(result_);
+
+}
+
+void ScopedResult::TrackDriverStatistics(QSqlDriver *driver) {
+
+  // Drivers without a "statistics" property (anything but the bundled ODBC driver) are ignored.
+  const QVariant stats = driver ? driver->property("statistics") : QVariant();
+  if (!stats.isValid()) return;
+
+  driver_ = driver;
+  driver_stats_start_ = stats.toMap();
+
+}
+
+void ScopedResult::FinishDriverStatistics() {
+
+  if (!driver_) return;
+
+  // Attribute the statements run on the connection since it was tracked to this result.
+  const QVariantMap stats = driver_->property("statistics").toMap();
+  QVariantMap driver_stats = result_.driver_stats();
+  for (QVariantMap::const_iterator it = stats.begin() ; it != stats.end() ; ++it) {
+    driver_stats.insert(it.key(), driver_stats.value(it.key()).toLongLong() + it.value().toLongLong() - driver_stats_start_.value(it.key()).toLongLong());
   }
-  emit Finished1(success_);
-  emit Finished2(filename_, success_, errors_);
+  result_.set_driver_stats(driver_stats);
+
+  driver_ = nullptr;
+  driver_stats_start_.clear();
 
 }
 
 void ScopedResult::failure(const QString &error) {
 
   pending_ = false;
-  success_ = false;
+  result_.set_success(false);
 
   if (!error.isEmpty()) {
     qLog(Error) << error;
-    errors_ << error;
+    result_.add_error(error);
   }
 
 }
@@ -62,10 +105,10 @@ void ScopedResult::failure(const QString &error) {
 void ScopedResult::failure(const QStringList &errors) {
 
   pending_ = false;
-  success_ = false;
+  result_.set_success(false);
   for (const QString &error : errors) {
     qLog(Error) << error;
-    errors_ << error;
+    result_.add_error(error);
   }
 
 }
@@ -73,6 +116,6 @@ void ScopedResult::failure(const QStringList &errors) {
 void ScopedResult::success() {
 
   pending_ = false;
-  success_ = true;
+  result_.set_success(true);
 
 }
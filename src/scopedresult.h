@@ -22,9 +22,16 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <QtGlobal>
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QVariantMap>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QSqlDriver>
+
+#include "backupresult.h"
 
 class ScopedResult : public QObject, boost::noncopyable {
   Q_OBJECT
@@ -37,22 +44,43 @@ class ScopedResult : public QObject, boost::noncopyable {
   void failure(const QString &error = QString());
   void failure(const QStringList &errors);
   void success();
-  void set_filename(const QString &filename) { filename_ = filename; }
+  void set_filename(const QString &filename) { result_.set_filename(filename); }
+  void set_server(const QString &server) { result_.set_server(server); }
+  void add_phase_nsecs(const BackupResult::Phase phase, const qint64 nsecs) { result_.add_phase_nsecs(phase, nsecs); }
+  void set_bytes_unzipped(const quint64 bytes) { result_.set_bytes_unzipped(bytes); }
+  void set_bytes_restored(const quint64 bytes) { result_.set_bytes_restored(bytes); }
+  void TrackDriverStatistics(QSqlDriver *driver);
+  // Must be called before the tracked connection is returned to the pool, the driver may be deleted or used by another thread after that.
+  void FinishDriverStatistics();
 
  signals:
   void Started();
   void Finished1(bool success);
-  void Finished2(QString filename, bool success, QStringList errors);
+  void Finished2(BackupResult result);
   void Status(QString message);
   void Success();
   void Failure(QString error);
   void Failure(QStringList errors);
 
  private:
-  QString filename_;
+  BackupResult result_;
+  QElapsedTimer timer_;
   bool pending_;
-  bool success_;
-  QStringList errors_;
+  QPointer<QSqlDriver> driver_;
+  QVariantMap driver_stats_start_;
+};
+
+// Adds the time spent in the current scope to a phase of the result.
+class ScopedPhaseTimer : boost::noncopyable {
+
+ public:
+  explicit ScopedPhaseTimer(ScopedResult *r, const BackupResult::Phase phase) : result_(r), phase_(phase) { timer_.start(); }
+  ~ScopedPhaseTimer() { result_->add_phase_nsecs(phase_, timer_.nsecsElapsed()); }
+
+ private:
+  ScopedResult *result_;
+  BackupResult::Phase phase_;
+  QElapsedTimer timer_;
 };
 
 #endif  // SCOPEDRESULT_H
@@ -30,7 +30,6 @@
 #include <QWidget>
 #include <QCoreApplication>
 #include <QSettings>
-#include <QMutex>
 #include <QtConcurrent>
 #include <QFuture>
 #include <QFutureWatcher>
@@ -222,6 +221,8 @@ void SettingsDialog::Load() {
   else ui_->password->setText(QString::fromUtf8(QByteArray::fromBase64(password)));
   ui_->remote_path->setText(s.value("remote_path", QDir::toNativeSeparators(QCoreApplication::applicationDirPath())).toString());
   ui_->local_path->setText(s.value("local_path", QDir::toNativeSeparators(QCoreApplication::applicationDirPath())).toString());
+  ui_->buffer_count->setValue(s.value("buffer_count", 0).toInt());
+  ui_->max_transfer_size->setValue(s.value("max_transfer_size", 0).toInt());
 
   s.endGroup();
 
@@ -240,6 +241,8 @@ void SettingsDialog::Save() {
   s.setValue("login_timeout", ui_->login_timeout->value());
   s.setValue("remote_path", ui_->remote_path->text());
   s.setValue("local_path", ui_->local_path->text());
+  s.setValue("buffer_count", ui_->buffer_count->value());
+  s.setValue("max_transfer_size", ui_->max_transfer_size->value());
   s.endGroup();
 
   emit SettingsChanged();
@@ -291,7 +294,6 @@ void SettingsDialog::TestServer() {
 
 DBConnectResult SettingsDialog::Connect() {
 
-  QMutexLocker l(db_connector_->Mutex());
   return db_connector_->Connect(ui_->drivers->currentData().toString(), ui_->odbc_drivers->currentData().toString(), ui_->server->text(), ui_->trusted_connection->isChecked(), ui_->username->text(), ui_->password->text(), 4, true);
 
 }